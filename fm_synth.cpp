@@ -1,15 +1,19 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <string>
 #include <memory>
 #include <atomic>
 #include <rtaudio/RtAudio.h>
+#include "synth/denormals.h"
+#include "synth/sample_rate.h"
+#include "synth/saturator.h"
+#include "synth/note_table.h"
 
 // =====================
 // Constantes
 // =====================
 const double PI = 3.14159265358979323846;
-const double SAMPLE_RATE = 44100.0;
 
 // =====================
 // Oscilador sinusoidal
@@ -68,7 +72,7 @@ public:
         if (gate) {
             value += (1.0 - value) * attack;
         } else {
-            value *= release;
+            value = flushBelow(value * release, (double)getDenormalFloor());
         }
         return value;
     }
@@ -86,6 +90,7 @@ private:
     std::atomic<double> modulatorRatio;
     std::atomic<bool> isActive;
     std::atomic<double> currentFrequency;
+    double indexScale = 1.0;            // escalado del indice por altura (de la tabla de notas)
 
     // Amplitud base
     double amplitude = 0.4;
@@ -102,8 +107,6 @@ private:
     // Saturación
     double drive = 1.5;
 
-    static constexpr double referenceFreq = 440.0;
-
 public:
     FMSynth(double freq, double modRatio, double modIndex, double sr)
         : carrier(freq, sr),
@@ -126,7 +129,11 @@ public:
         if (!isActive.load()) {
             // Release natural
             env *= releaseCoeff;
-            if (env < 1e-5) return 0.0;
+            if (env < 1e-5) {
+                env = 0.0;
+                lpState = 0.0;
+                return 0.0;
+            }
         } else {
             // Attack
             env = 1.0 - (1.0 - env) * attackCoeff;
@@ -137,12 +144,8 @@ public:
         // ==========================
         double out = 0.0;
 
+        double effectiveIndex = modulationIndex.load() * indexScale;
         for (int i = 0; i < 2; ++i) {
-            // Escalado de índice por pitch
-            double freq = currentFrequency.load();
-            double pitchScale = referenceFreq / freq;
-            double effectiveIndex = modulationIndex.load() * pitchScale;
-
             // FM
             double mod = modulator.process();
             double phaseMod = effectiveIndex * mod;
@@ -154,18 +157,21 @@ public:
         out *= 0.5;
 
         // Saturación suave
-        out = std::tanh(out * drive);
+        out = fastTanh(out * drive);
 
         // Aplicar envolvente
         out *= env * amplitude;
 
         // Filtro post-voz
         lpState += lpCoeff * (out - lpState);
+        lpState = flushBelow(lpState, (double)getDenormalFloor());
 
         return lpState;
     }
 
-    void noteOn(double freq, double modRatio) {
+    void noteOn(const NoteEntry& note, double modRatio) {
+        double freq = note.frequency;
+        indexScale = note.indexScale;
         currentFrequency.store(freq);
         modulatorRatio.store(modRatio);
 
@@ -204,6 +210,8 @@ std::unique_ptr<FMSynth> synth;
 int audioCallback(void *outputBuffer, void *, unsigned int nFrames,
                   double, RtAudioStreamStatus status, void *) {
 
+    ScopedDenormalGuard denormalGuard;
+
     double *buffer = (double *)outputBuffer;
 
     if (status)
@@ -217,19 +225,10 @@ int audioCallback(void *outputBuffer, void *, unsigned int nFrames,
     return 0;
 }
 
-// =====================
-// MIDI → Hz
-// =====================
-double midiToFreq(int note) {
-    return 440.0 * std::pow(2.0, (note - 69) / 12.0);
-}
-
 // =====================
 // Main
 // =====================
 int main() {
-    synth = std::make_unique<FMSynth>(440.0, 2.0, 3.0, SAMPLE_RATE);
-
     RtAudio dac;
     RtAudio::StreamParameters params;
     params.deviceId = dac.getDefaultOutputDevice();
@@ -237,13 +236,26 @@ int main() {
 
     unsigned int bufferFrames = 256;
 
+    // Frecuencia nativa del dispositivo (44.1 / 48 / 88.2 / 96 / 192 kHz)
+    RtAudio::DeviceInfo info = dac.getDeviceInfo(params.deviceId);
+    unsigned int sampleRate = chooseSampleRate(info.sampleRates, info.preferredSampleRate);
+
     dac.openStream(&params, nullptr, RTAUDIO_FLOAT64,
-                   (unsigned int)SAMPLE_RATE, &bufferFrames,
+                   sampleRate, &bufferFrames,
                    &audioCallback, nullptr);
 
+    synth = std::make_unique<FMSynth>(440.0, 2.0, 3.0, (double)dac.getStreamSampleRate());
+
+    // Indice proporcional a 440 / frecuencia: mismo brillo en todo el teclado
+    KeyScaling scaling;
+    scaling.indexTracking = 1.0;
+    Tuning tuning;
+    NoteTable noteTable;
+    noteTable.build(scaling, tuning);
+
     dac.startStream();
 
-    std::cout << "n <nota> <ratio> <index> | o | q" << std::endl;
+    std::cout << "n <nota> <ratio> <index> | o | t <escala.scl> | k <mapeo.kbm> | q" << std::endl;
 
     char c;
     while (std::cin >> c) {
@@ -251,10 +263,18 @@ int main() {
         if (c == 'n') {
             int note; double ratio, idx;
             std::cin >> note >> ratio >> idx;
+            if (noteTable[note].frequency <= 0.0) continue;
             synth->setModulationIndex(idx);
-            synth->noteOn(midiToFreq(note), ratio);
+            synth->noteOn(noteTable[note], ratio);
         }
         if (c == 'o') synth->noteOff();
+        if (c == 't' || c == 'k') {
+            std::string path;
+            std::cin >> path;
+            bool ok = c == 't' ? tuning.loadScale(path.c_str()) : tuning.loadKeyboardMapping(path.c_str());
+            std::cout << (ok ? "Cargado: " : "No se pudo leer: ") << path << std::endl;
+            noteTable.build(scaling, tuning);
+        }
     }
 
     dac.stopStream();
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <string>
 #include <memory>
 #include <atomic>
 #include <cstdlib>
@@ -18,7 +19,8 @@
 #include "synth/effects.h"
 #include "synth/fm_synth.h"
 #include "synth/waveform_buffer.h"
-#include "synth/voice.h"
+#include "synth/sample_rate.h"
+#include "synth/engine.h"
 
 // Headers de GUI
 #include "gui/gui_utils.h"
@@ -29,28 +31,40 @@
 // Variables globales
 // ============================================================================
 
-Voice voices[NUM_VOICES];
+std::unique_ptr<SynthEngine<Sample>> engine;
 std::unique_ptr<WaveformBuffer> waveformBuffer;
-std::unique_ptr<JunoChorus> chorus;
-std::unique_ptr<AtmosphericReverb> reverbL;
-std::unique_ptr<AtmosphericReverb> reverbR;
-std::unique_ptr<Filter> filterL;
-std::unique_ptr<Filter> filterR;
-
-std::atomic<double> chorusMix(0.0);
-std::atomic<double> reverbMix(0.0);
-std::atomic<int> filterType(FILTER_OFF);
-std::atomic<double> filterCutoff(2000.0);
-std::atomic<double> filterQ(0.707);
+
+const int GUI_FPS = 60;
+
+// El stream de RtAudio usa el mismo tipo que el motor (float32 salvo build de referencia)
+const RtAudioFormat STREAM_FORMAT = sizeof(Sample) == sizeof(float) ? RTAUDIO_FLOAT32 : RTAUDIO_FLOAT64;
 
 // GUI params (Init preset: pure sine wave)
 float guiRatio1 = 1.0f, guiRatio2 = 1.0f, guiRatio3 = 1.0f, guiRatio4 = 1.0f;
 float guiIndex1 = 0.0f, guiIndex2 = 0.0f, guiIndex3 = 0.0f, guiIndex4 = 0.0f;
 float guiAttack = 0.01f, guiDecay = 0.1f, guiSustain = 1.0f, guiRelease = 0.2f;
 float guiChorus = 0.0f, guiReverb = 0.0f;
+int guiReverbType = REVERB_SCHROEDER;
+float guiFdnLow = 2.5f, guiFdnHigh = 1.2f, guiFdnCross = 3000.0f;     // RT60 en s y cruce en Hz
+bool guiSatEnabled = false, guiSatOversample = false;
+int guiSatCurve = SAT_TANH;
+float guiSatDrive = 1.0f;
+float guiPan = 0.0f, guiSpread = 0.0f;      // paneo base y ancho del spread
+int guiSpreadMode = SPREAD_KEY;
+float guiGlide = 0.0f;                       // ms por nota (Time) o por octava (Rate); 0 = apagado
+int guiGlideMode = GLIDE_TIME;
+// Rutas libres de la matriz editables desde el panel MATRIX (destino -1 = apagada)
+const int GUI_MOD_ROUTES = 2;
+int guiRouteSource[GUI_MOD_ROUTES] = {MOD_SRC_VELOCITY, MOD_SRC_KEY};
+int guiRouteDest[GUI_MOD_ROUTES] = {-1, -1};
+float guiRouteAmount[GUI_MOD_ROUTES] = {0.0f, 0.0f};
+int guiRouteSelected = 0;
+float guiLimLookahead = 2.0f, guiLimCeiling = -0.3f, guiLimRelease = 50.0f;     // ms, dBFS, ms
 int guiFilterType = 0;
 float guiFilterCutoff = 2000.0f, guiFilterQ = 0.707f;
 int guiAlgorithm = 0;
+int guiOpWave1 = WAVE_W1, guiOpWave2 = WAVE_W1, guiOpWave3 = WAVE_W1, guiOpWave4 = WAVE_W1;
+int guiOpTable1 = 0, guiOpTable2 = 0, guiOpTable3 = 0, guiOpTable4 = 0;
 int currentOctave = 5;
 std::vector<int> activeNotes;
 
@@ -58,13 +72,17 @@ std::vector<int> activeNotes;
 float guiLfo1Rate = 2.0f, guiLfo1Depth = 0.0f;
 float guiLfo2Rate = 4.0f, guiLfo2Depth = 0.0f;
 int guiLfo1Target = LFO_OFF, guiLfo2Target = LFO_OFF;
+int guiLfo1Wave = LFO_SINE, guiLfo2Wave = LFO_SINE;
 bool lfo1DropdownOpen = false, lfo2DropdownOpen = false;
-std::unique_ptr<LFO> lfo1, lfo2;
 
 // Mod Envelope params
 float guiModAttack = 0.01f, guiModDecay = 0.3f, guiModSustain = 0.0f, guiModRelease = 0.2f;
 float guiModAmount = 0.0f;
 int guiModEnvTarget = MODENV_OFF;
+
+// Unison del patch (copias por nota y desafinacion en cents)
+int guiUnisonVoices = 1;
+float guiUnisonDetune = 0.0f;
 bool modEnvDropdownOpen = false;
 
 // Preset system
@@ -86,10 +104,16 @@ void saveToPreset(int idx) {
     presets[idx].lfo1Rate = guiLfo1Rate; presets[idx].lfo1Depth = guiLfo1Depth;
     presets[idx].lfo2Rate = guiLfo2Rate; presets[idx].lfo2Depth = guiLfo2Depth;
     presets[idx].lfo1Target = guiLfo1Target; presets[idx].lfo2Target = guiLfo2Target;
+    presets[idx].lfo1Wave = guiLfo1Wave; presets[idx].lfo2Wave = guiLfo2Wave;
     presets[idx].modAttack = guiModAttack; presets[idx].modDecay = guiModDecay;
     presets[idx].modSustain = guiModSustain; presets[idx].modRelease = guiModRelease;
     presets[idx].modAmount = guiModAmount;
     presets[idx].modEnvTarget = guiModEnvTarget;
+    presets[idx].unisonVoices = guiUnisonVoices; presets[idx].unisonDetune = guiUnisonDetune;
+    presets[idx].opWave1 = guiOpWave1; presets[idx].opWave2 = guiOpWave2;
+    presets[idx].opWave3 = guiOpWave3; presets[idx].opWave4 = guiOpWave4;
+    presets[idx].opTable1 = guiOpTable1; presets[idx].opTable2 = guiOpTable2;
+    presets[idx].opTable3 = guiOpTable3; presets[idx].opTable4 = guiOpTable4;
 }
 
 void loadFromPreset(int idx) {
@@ -107,55 +131,16 @@ void loadFromPreset(int idx) {
     guiLfo1Rate = presets[idx].lfo1Rate; guiLfo1Depth = presets[idx].lfo1Depth;
     guiLfo2Rate = presets[idx].lfo2Rate; guiLfo2Depth = presets[idx].lfo2Depth;
     guiLfo1Target = presets[idx].lfo1Target; guiLfo2Target = presets[idx].lfo2Target;
+    guiLfo1Wave = presets[idx].lfo1Wave; guiLfo2Wave = presets[idx].lfo2Wave;
     guiModAttack = presets[idx].modAttack; guiModDecay = presets[idx].modDecay;
     guiModSustain = presets[idx].modSustain; guiModRelease = presets[idx].modRelease;
     guiModAmount = presets[idx].modAmount;
     guiModEnvTarget = presets[idx].modEnvTarget;
-}
-
-// ============================================================================
-// Voice management
-// ============================================================================
-
-int findFreeVoice() {
-    for (int i = 0; i < NUM_VOICES; i++) {
-        if (voices[i].note == -1 && !voices[i].synth->isActive()) return i;
-    }
-    for (int i = 0; i < NUM_VOICES; i++) {
-        if (voices[i].note == -1) return i;
-    }
-    return 0;
-}
-
-int findVoiceWithNote(int note) {
-    for (int i = 0; i < NUM_VOICES; i++) {
-        if (voices[i].note == note) return i;
-    }
-    return -1;
-}
-
-void voiceNoteOn(int note, double freq) {
-    int existing = findVoiceWithNote(note);
-    if (existing >= 0) return;
-
-    int v = findFreeVoice();
-    voices[v].synth->noteOn(freq);
-    voices[v].note = note;
-}
-
-void voiceNoteOff(int note) {
-    int v = findVoiceWithNote(note);
-    if (v >= 0) {
-        voices[v].synth->noteOff();
-        voices[v].note = -1;
-    }
-}
-
-bool isNoteActive(int note) {
-    for (int v = 0; v < NUM_VOICES; v++) {
-        if (voices[v].note == note) return true;
-    }
-    return false;
+    guiUnisonVoices = presets[idx].unisonVoices; guiUnisonDetune = presets[idx].unisonDetune;
+    guiOpWave1 = presets[idx].opWave1; guiOpWave2 = presets[idx].opWave2;
+    guiOpWave3 = presets[idx].opWave3; guiOpWave4 = presets[idx].opWave4;
+    guiOpTable1 = presets[idx].opTable1; guiOpTable2 = presets[idx].opTable2;
+    guiOpTable3 = presets[idx].opTable3; guiOpTable4 = presets[idx].opTable4;
 }
 
 // ============================================================================
@@ -165,71 +150,35 @@ bool isNoteActive(int note) {
 int audioCallback(void *outputBuffer, void *inputBuffer, unsigned int nFrames,
                   double streamTime, RtAudioStreamStatus status, void *userData) {
 
-    double *buffer = (double *)outputBuffer;
-    double chMix = chorusMix.load();
-    double rvMix = reverbMix.load();
-    int fType = filterType.load();
+    Sample *buffer = (Sample *)outputBuffer;
+    engine->render(buffer, (int)nFrames);
 
     for (unsigned int i = 0; i < nFrames; i++) {
-        double sample = 0.0;
-
-        for (int v = 0; v < NUM_VOICES; v++) {
-            sample += voices[v].synth->process();
-        }
-
-        sample *= 0.4;
-
-        if (fType != FILTER_OFF) {
-            sample = filterL->process(sample);
-        }
-
-        double outL, outR;
-        chorus->process(sample, outL, outR, chMix);
-
-        outL = reverbL->process(outL, rvMix);
-        outR = reverbR->process(outR, rvMix);
-
-        outL = std::tanh(outL);
-        outR = std::tanh(outR);
-
-        waveformBuffer->write((float)((outL + outR) * 0.5));
-        *buffer++ = outL;
-        *buffer++ = outR;
+        waveformBuffer->write((float)((buffer[2 * i] + buffer[2 * i + 1]) * 0.5));
     }
 
     return 0;
 }
 
-// ============================================================================
-// Utility
-// ============================================================================
-
-double midiToFreq(int midiNote) {
-    return 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
-}
-
 // ============================================================================
 // Main
 // ============================================================================
 
-int main() {
+int main(int argc, char** argv) {
+    // --make-bank <banco.fmwt> <ciclo.wav>...: arma un banco de wavetables y sale
+    if (argc > 3 && std::string(argv[1]) == "--make-bank") {
+        std::vector<std::string> wavs(argv + 3, argv + argc);
+        bool ok = writeWavetableBank(argv[2], wavs);
+        std::cout << (ok ? "Wavetable bank written: " : "Could not write wavetable bank: ") << argv[2] << std::endl;
+        return ok ? 0 : 1;
+    }
+
     srand((unsigned int)time(NULL));
     initPresets(presets);
 
-    for (int i = 0; i < NUM_VOICES; i++) {
-        voices[i].synth = std::make_unique<FMSynth>(440.0, SAMPLE_RATE);
-        voices[i].note = -1;
-    }
+    engine = std::make_unique<SynthEngine<Sample>>();
     waveformBuffer = std::make_unique<WaveformBuffer>(WAVEFORM_SIZE);
 
-    chorus = std::make_unique<JunoChorus>(SAMPLE_RATE);
-    reverbL = std::make_unique<AtmosphericReverb>(SAMPLE_RATE);
-    reverbR = std::make_unique<AtmosphericReverb>(SAMPLE_RATE);
-    filterL = std::make_unique<Filter>(SAMPLE_RATE);
-    filterR = std::make_unique<Filter>(SAMPLE_RATE);
-    lfo1 = std::make_unique<LFO>(60.0);
-    lfo2 = std::make_unique<LFO>(60.0);
-
     RtAudio dac;
 
     if (dac.getDeviceCount() < 1) {
@@ -244,8 +193,12 @@ int main() {
 
     unsigned int bufferFrames = 256;
 
-    RtAudioErrorType result = dac.openStream(&parameters, NULL, RTAUDIO_FLOAT64,
-                  (unsigned int)SAMPLE_RATE, &bufferFrames,
+    // Usar la frecuencia nativa del dispositivo para evitar el remuestreo del SO
+    RtAudio::DeviceInfo info = dac.getDeviceInfo(parameters.deviceId);
+    unsigned int sampleRate = chooseSampleRate(info.sampleRates, info.preferredSampleRate);
+
+    RtAudioErrorType result = dac.openStream(&parameters, NULL, STREAM_FORMAT,
+                  sampleRate, &bufferFrames,
                   &audioCallback, nullptr);
 
     if (result != RTAUDIO_NO_ERROR) {
@@ -253,17 +206,63 @@ int main() {
         return 1;
     }
 
+    engine->prepare((double)dac.getStreamSampleRate());
+    // Argumentos: .scl y .kbm cargan la afinacion, --wave <ciclo.wav> la
+    // forma de onda User, --bank <banco.fmwt> las tablas Bank y cualquier
+    // otro es una IR
+    const char* sclPath = nullptr;
+    const char* kbmPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bank" && i + 1 < argc) {
+            const char* path = argv[++i];
+            if (engine->loadWavetableBank(path)) {
+                std::cout << "Wavetable bank loaded: " << path << " (" << engine->getBankTableCount() << " tables)" << std::endl;
+            } else {
+                std::cout << "Could not load wavetable bank: " << path << std::endl;
+            }
+            continue;
+        }
+        if (arg == "--wave" && i + 1 < argc) {
+            const char* path = argv[++i];
+            if (engine->loadUserWavetable(path)) {
+                std::cout << "User wavetable loaded: " << path << std::endl;
+            } else {
+                std::cout << "Could not load wavetable: " << path << std::endl;
+            }
+            continue;
+        }
+        std::string ext = arg.size() > 4 ? arg.substr(arg.size() - 4) : "";
+        if (ext == ".scl") {
+            sclPath = argv[i];
+        } else if (ext == ".kbm") {
+            kbmPath = argv[i];
+        } else if (engine->loadImpulseResponse(argv[i])) {
+            std::cout << "Impulse response loaded: " << argv[i] << std::endl;
+        } else {
+            std::cout << "Could not load impulse response: " << argv[i] << std::endl;
+        }
+    }
+    if (sclPath) {
+        if (engine->loadTuning(sclPath, kbmPath)) {
+            std::cout << "Tuning loaded: " << sclPath << std::endl;
+        } else {
+            std::cout << "Could not load tuning: " << sclPath << std::endl;
+        }
+    }
+    std::cout << "Sample rate: " << engine->getSampleRate() << " Hz" << std::endl;
+
     result = dac.startStream();
     if (result != RTAUDIO_NO_ERROR) {
         std::cout << "Error starting audio stream" << std::endl;
         return 1;
     }
 
-    const int screenWidth = 650;
-    const int screenHeight = 520;
+    const int screenWidth = 760;
+    const int screenHeight = 595;
 
     InitWindow(screenWidth, screenHeight, "FM Synth - 4 Op / 16 Voices");
-    SetTargetFPS(60);
+    SetTargetFPS(GUI_FPS);
 
     // Mapeo de teclado
     const int whiteKeyMapping[] = { KEY_A, KEY_S, KEY_D, KEY_F, KEY_G, KEY_H, KEY_J, KEY_K, KEY_L, KEY_SEMICOLON };
@@ -279,80 +278,55 @@ int main() {
     const int ROW_H = 120;
 
     while (!WindowShouldClose()) {
-        // Process LFOs
-        float lfo1Val = lfo1->process(guiLfo1Rate, guiLfo1Depth);
-        float lfo2Val = lfo2->process(guiLfo2Rate, guiLfo2Depth);
-
-        // Apply LFO modulation
-        float modRatio1 = applyLfoMod(guiRatio1, LFO_RATIO1, guiLfo1Target, lfo1Val, 0.5f, 8.0f);
-        modRatio1 = applyLfoMod(modRatio1, LFO_RATIO1, guiLfo2Target, lfo2Val, 0.5f, 8.0f);
-        float modRatio2 = applyLfoMod(guiRatio2, LFO_RATIO2, guiLfo1Target, lfo1Val, 0.5f, 8.0f);
-        modRatio2 = applyLfoMod(modRatio2, LFO_RATIO2, guiLfo2Target, lfo2Val, 0.5f, 8.0f);
-        float modRatio3 = applyLfoMod(guiRatio3, LFO_RATIO3, guiLfo1Target, lfo1Val, 0.5f, 8.0f);
-        modRatio3 = applyLfoMod(modRatio3, LFO_RATIO3, guiLfo2Target, lfo2Val, 0.5f, 8.0f);
-        float modRatio4 = applyLfoMod(guiRatio4, LFO_RATIO4, guiLfo1Target, lfo1Val, 0.5f, 8.0f);
-        modRatio4 = applyLfoMod(modRatio4, LFO_RATIO4, guiLfo2Target, lfo2Val, 0.5f, 8.0f);
-
-        float modIndex1 = applyLfoMod(guiIndex1, LFO_INDEX1, guiLfo1Target, lfo1Val, 0.0f, 10.0f);
-        modIndex1 = applyLfoMod(modIndex1, LFO_INDEX1, guiLfo2Target, lfo2Val, 0.0f, 10.0f);
-        float modIndex2 = applyLfoMod(guiIndex2, LFO_INDEX2, guiLfo1Target, lfo1Val, 0.0f, 10.0f);
-        modIndex2 = applyLfoMod(modIndex2, LFO_INDEX2, guiLfo2Target, lfo2Val, 0.0f, 10.0f);
-        float modIndex3 = applyLfoMod(guiIndex3, LFO_INDEX3, guiLfo1Target, lfo1Val, 0.0f, 10.0f);
-        modIndex3 = applyLfoMod(modIndex3, LFO_INDEX3, guiLfo2Target, lfo2Val, 0.0f, 10.0f);
-        float modIndex4 = applyLfoMod(guiIndex4, LFO_INDEX4, guiLfo1Target, lfo1Val, 0.0f, 10.0f);
-        modIndex4 = applyLfoMod(modIndex4, LFO_INDEX4, guiLfo2Target, lfo2Val, 0.0f, 10.0f);
-
-        float modFilterCut = applyLfoMod(guiFilterCutoff, LFO_FILTER_CUT, guiLfo1Target, lfo1Val, 100.0f, 8000.0f);
-        modFilterCut = applyLfoMod(modFilterCut, LFO_FILTER_CUT, guiLfo2Target, lfo2Val, 100.0f, 8000.0f);
-        float modFilterQ = applyLfoMod(guiFilterQ, LFO_FILTER_Q, guiLfo1Target, lfo1Val, 0.5f, 8.0f);
-        modFilterQ = applyLfoMod(modFilterQ, LFO_FILTER_Q, guiLfo2Target, lfo2Val, 0.5f, 8.0f);
-
-        float modChorus = applyLfoMod(guiChorus, LFO_CHORUS, guiLfo1Target, lfo1Val, 0.0f, 1.0f);
-        modChorus = applyLfoMod(modChorus, LFO_CHORUS, guiLfo2Target, lfo2Val, 0.0f, 1.0f);
-        float modReverb = applyLfoMod(guiReverb, LFO_REVERB, guiLfo1Target, lfo1Val, 0.0f, 1.0f);
-        modReverb = applyLfoMod(modReverb, LFO_REVERB, guiLfo2Target, lfo2Val, 0.0f, 1.0f);
-
-        // Apply Mod Envelope modulation (basado en guiModAmount)
-        float modEnvValue = guiModAmount;  // El amount actua como multiplicador
-        if (guiModEnvTarget == MODENV_INDEX1) {
-            modIndex1 = std::max(0.0f, std::min(10.0f, modIndex1 + modEnvValue * 5.0f));
-        } else if (guiModEnvTarget == MODENV_INDEX2) {
-            modIndex2 = std::max(0.0f, std::min(10.0f, modIndex2 + modEnvValue * 5.0f));
-        } else if (guiModEnvTarget == MODENV_INDEX3) {
-            modIndex3 = std::max(0.0f, std::min(10.0f, modIndex3 + modEnvValue * 5.0f));
-        } else if (guiModEnvTarget == MODENV_INDEX4) {
-            modIndex4 = std::max(0.0f, std::min(10.0f, modIndex4 + modEnvValue * 5.0f));
-        } else if (guiModEnvTarget == MODENV_FILTER_CUT) {
-            modFilterCut = std::max(100.0f, std::min(8000.0f, modFilterCut + modEnvValue * 4000.0f));
-        }
-
         // Update voices
         for (int v = 0; v < NUM_VOICES; v++) {
-            voices[v].synth->setRatio1(modRatio1);
-            voices[v].synth->setRatio2(modRatio2);
-            voices[v].synth->setRatio3(modRatio3);
-            voices[v].synth->setRatio4(modRatio4);
-            voices[v].synth->setIndex1(modIndex1);
-            voices[v].synth->setIndex2(modIndex2);
-            voices[v].synth->setIndex3(modIndex3);
-            voices[v].synth->setIndex4(modIndex4);
-            voices[v].synth->setAlgorithm(guiAlgorithm);
-            voices[v].synth->setAttack(guiAttack);
-            voices[v].synth->setDecay(guiDecay);
-            voices[v].synth->setSustain(guiSustain);
-            voices[v].synth->setRelease(guiRelease);
+            FMSynth<Sample>& synth = engine->getVoice(v);
+            synth.setRatio1(guiRatio1);
+            synth.setRatio2(guiRatio2);
+            synth.setRatio3(guiRatio3);
+            synth.setRatio4(guiRatio4);
+            synth.setIndex1(guiIndex1);
+            synth.setIndex2(guiIndex2);
+            synth.setIndex3(guiIndex3);
+            synth.setIndex4(guiIndex4);
+            synth.setAlgorithm(guiAlgorithm);
+            synth.setUnison(guiUnisonVoices, guiUnisonDetune);
+            synth.setAttack(guiAttack);
+            synth.setDecay(guiDecay);
+            synth.setSustain(guiSustain);
+            synth.setRelease(guiRelease);
+            synth.setModAttack(guiModAttack);
+            synth.setModDecay(guiModDecay);
+            synth.setModSustain(guiModSustain);
+            synth.setModRelease(guiModRelease);
         }
 
-        chorusMix.store(modChorus);
-        reverbMix.store(modReverb);
-        filterType.store(guiFilterType);
-        if (guiFilterType == FILTER_LOWPASS) {
-            filterL->setLowPass(modFilterCut, modFilterQ);
-            filterR->setLowPass(modFilterCut, modFilterQ);
-        } else if (guiFilterType == FILTER_HIGHPASS) {
-            filterL->setHighPass(modFilterCut, modFilterQ);
-            filterR->setHighPass(modFilterCut, modFilterQ);
+        engine->setOperatorBankTable(0, guiOpTable1);
+        engine->setOperatorBankTable(1, guiOpTable2);
+        engine->setOperatorBankTable(2, guiOpTable3);
+        engine->setOperatorBankTable(3, guiOpTable4);
+        engine->setOperatorWaveform(0, guiOpWave1);
+        engine->setOperatorWaveform(1, guiOpWave2);
+        engine->setOperatorWaveform(2, guiOpWave3);
+        engine->setOperatorWaveform(3, guiOpWave4);
+        engine->collectRetiredTables();
+        engine->setChorusMix(guiChorus);
+        engine->setReverbMix(guiReverb);
+        engine->setReverbType(guiReverbType);
+        engine->setFdnDecay(guiFdnLow, guiFdnHigh, guiFdnCross);
+        engine->setSaturationEnabled(guiSatEnabled);
+        engine->setSaturation(guiSatCurve, guiSatDrive, guiSatOversample);
+        engine->setLimiter(guiLimLookahead, guiLimCeiling, guiLimRelease);
+        engine->setPan(guiPan);
+        engine->setSpread(guiSpread, guiSpreadMode);
+        engine->setGlide(guiGlideMode, guiGlide);
+        for (int r = 0; r < GUI_MOD_ROUTES; r++) {
+            engine->setModRoute(r, guiRouteSource[r], guiRouteDest[r], guiRouteAmount[r]);
         }
+        engine->setFilter(guiFilterType, guiFilterCutoff, guiFilterQ);
+        engine->setLfo(0, guiLfo1Rate, guiLfo1Depth, guiLfo1Target, guiLfo1Wave);
+        engine->setLfo(1, guiLfo2Rate, guiLfo2Depth, guiLfo2Target, guiLfo2Wave);
+        engine->setModEnvelope(guiModEnvTarget, guiModAmount);
 
         // Keyboard input
         std::vector<int> currentKeys;
@@ -385,10 +359,21 @@ int main() {
         Color op3Color = Color{100, 180, 100, 255};
         Color op4Color = Color{180, 100, 180, 255};
 
-        DrawOperatorPanel(15, ROW1_Y, "OP1", &guiRatio1, &guiIndex1, op1Color, true, "FB");
-        DrawOperatorPanel(90, ROW1_Y, "OP2", &guiRatio2, &guiIndex2, op2Color, false, "I");
-        DrawOperatorPanel(165, ROW1_Y, "OP3", &guiRatio3, &guiIndex3, op3Color, false, "I");
-        DrawOperatorPanel(240, ROW1_Y, "OP4", &guiRatio4, &guiIndex4, op4Color, false, "I");
+        int bankTables = engine->getBankTableCount();
+        char waveLabel[4][8];
+        int* opWaves[4] = {&guiOpWave1, &guiOpWave2, &guiOpWave3, &guiOpWave4};
+        int* opTables[4] = {&guiOpTable1, &guiOpTable2, &guiOpTable3, &guiOpTable4};
+        for (int k = 0; k < 4; k++) {
+            if (*opWaves[k] == WAVE_BANK) {
+                snprintf(waveLabel[k], sizeof(waveLabel[k]), "B%d", *opTables[k] + 1);
+            } else {
+                snprintf(waveLabel[k], sizeof(waveLabel[k]), "%s", operatorWaveformNames[*opWaves[k]]);
+            }
+        }
+        DrawOperatorPanel(15, ROW1_Y, "OP1", &guiRatio1, &guiIndex1, &guiOpWave1, WAVE_COUNT, waveLabel[0], &guiOpTable1, bankTables, op1Color, true, "FB");
+        DrawOperatorPanel(90, ROW1_Y, "OP2", &guiRatio2, &guiIndex2, &guiOpWave2, WAVE_COUNT, waveLabel[1], &guiOpTable2, bankTables, op2Color, false, "I");
+        DrawOperatorPanel(165, ROW1_Y, "OP3", &guiRatio3, &guiIndex3, &guiOpWave3, WAVE_COUNT, waveLabel[2], &guiOpTable3, bankTables, op3Color, false, "I");
+        DrawOperatorPanel(240, ROW1_Y, "OP4", &guiRatio4, &guiIndex4, &guiOpWave4, WAVE_COUNT, waveLabel[3], &guiOpTable4, bankTables, op4Color, false, "I");
 
         // ADSR Panel
         DrawADSRPanel(320, ROW1_Y, &guiAttack, &guiDecay, &guiSustain, &guiRelease, "ADSR", Color{200, 180, 100, 255});
@@ -428,7 +413,16 @@ int main() {
             Color lfo1Color = Color{100, 180, 180, 255};
             DrawRectangle(lfo1PanelX, lfo1PanelY, pw, panelH, Color{35, 35, 45, 255});
             DrawRectangleLines(lfo1PanelX, lfo1PanelY, pw, panelH, lfo1Color);
-            DrawText("LFO 1", lfo1PanelX + 20, lfo1PanelY + 4, 10, lfo1Color);
+            DrawText("LFO 1", lfo1PanelX + 6, lfo1PanelY + 4, 10, lfo1Color);
+
+            // Click en el titulo: siguiente forma de onda
+            DrawText(lfoWaveformNames[guiLfo1Wave], lfo1PanelX + 44, lfo1PanelY + 5, 8, WHITE);
+            {
+                Vector2 m = GetMousePosition();
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= lfo1PanelX && m.x <= lfo1PanelX + pw && m.y >= lfo1PanelY && m.y <= lfo1PanelY + 14) {
+                    guiLfo1Wave = (guiLfo1Wave + 1) % LFO_WAVEFORM_COUNT;
+                }
+            }
 
             // Knobs uno encima del otro con mas espacio
             DrawKnob(lfo1PanelX + 35, lfo1PanelY + 38, 13, "Rate", &guiLfo1Rate, 0.1f, 20.0f, lfo1Color);
@@ -443,7 +437,16 @@ int main() {
             Color lfo2Color = Color{180, 140, 100, 255};
             DrawRectangle(lfo2PanelX, lfo2PanelY, pw, panelH, Color{35, 35, 45, 255});
             DrawRectangleLines(lfo2PanelX, lfo2PanelY, pw, panelH, lfo2Color);
-            DrawText("LFO 2", lfo2PanelX + 20, lfo2PanelY + 4, 10, lfo2Color);
+            DrawText("LFO 2", lfo2PanelX + 6, lfo2PanelY + 4, 10, lfo2Color);
+
+            // Click en el titulo: siguiente forma de onda
+            DrawText(lfoWaveformNames[guiLfo2Wave], lfo2PanelX + 44, lfo2PanelY + 5, 8, WHITE);
+            {
+                Vector2 m = GetMousePosition();
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= lfo2PanelX && m.x <= lfo2PanelX + pw && m.y >= lfo2PanelY && m.y <= lfo2PanelY + 14) {
+                    guiLfo2Wave = (guiLfo2Wave + 1) % LFO_WAVEFORM_COUNT;
+                }
+            }
 
             DrawKnob(lfo2PanelX + 35, lfo2PanelY + 38, 13, "Rate", &guiLfo2Rate, 0.1f, 20.0f, lfo2Color);
             DrawKnob(lfo2PanelX + 35, lfo2PanelY + 90, 13, "Depth", &guiLfo2Depth, 0.0f, 1.0f, lfo2Color);
@@ -457,8 +460,22 @@ int main() {
             DrawRectangleLines(px, py, pw, panelH, Color{150, 100, 180, 255});
             DrawText("FX", px + 28, py + 4, 10, Color{150, 100, 180, 255});
 
-            DrawVerticalSlider(px + 3, py + 20, 85, "Cho", &guiChorus, 0.0f, 1.0f, Color{100, 180, 220, 255});
-            DrawVerticalSlider(px + 36, py + 20, 85, "Rev", &guiReverb, 0.0f, 1.0f, Color{220, 150, 100, 255});
+            for (int i = 0; i < REVERB_TYPE_COUNT; i++) {
+                int btnW = 60 / REVERB_TYPE_COUNT;
+                int btnX = px + 5 + i * (btnW + 1), btnY = py + 18;
+                bool sel = (guiReverbType == i);
+                bool available = (i != REVERB_CONVOLUTION || engine->hasImpulseResponse());
+                DrawRectangle(btnX, btnY, btnW - 1, 14, sel ? Color{150, 100, 180, 255} : Color{45, 45, 55, 255});
+                DrawRectangleLines(btnX, btnY, btnW - 1, 14, sel ? WHITE : DARKGRAY);
+                int tw = MeasureText(reverbTypeNames[i], 8);
+                DrawText(reverbTypeNames[i], btnX + (btnW - 1 - tw) / 2, btnY + 3, 8, sel ? WHITE : (available ? GRAY : DARKGRAY));
+                Vector2 m = GetMousePosition();
+                if (available && IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= btnX && m.x <= btnX + btnW - 1 && m.y >= btnY && m.y <= btnY + 14) {
+                    guiReverbType = i;
+                }
+            }
+            DrawVerticalSlider(px + 3, py + 38, 70, "Cho", &guiChorus, 0.0f, 1.0f, Color{100, 180, 220, 255});
+            DrawVerticalSlider(px + 36, py + 38, 70, "Rev", &guiReverb, 0.0f, 1.0f, Color{220, 150, 100, 255});
         }
 
         // MOD ENV Panel - con grafico de envolvente
@@ -566,13 +583,170 @@ int main() {
                 int row = v / 8, col = v % 8;
                 int cx = px + 15 + col * 16;
                 int cy = py + 232 + row * 14;
-                bool active = voices[v].synth->isActive();
+                bool active = engine->isVoiceActive(v);
                 DrawCircle(cx, cy, 4, active ? Color{100, 200, 100, 255} : Color{40, 40, 50, 255});
             }
         }
 
+        // ==================== FILA 3: MASTER ====================
+        int row3Y = row2Y + panelH + 5;
+        int row3H = 70;
+
+        // FDN Panel: decay de graves y agudos y cruce entre las dos bandas
+        {
+            int px = 15, py = row3Y, pw = 110;
+            Color fdnColor = Color{220, 150, 100, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, fdnColor);
+            DrawText("FDN", px + 6, py + 4, 10, fdnColor);
+
+            DrawKnob(px + 20, py + 42, 13, "Low", &guiFdnLow, 0.1f, 10.0f, fdnColor);
+            DrawKnob(px + 55, py + 42, 13, "High", &guiFdnHigh, 0.1f, 10.0f, fdnColor);
+            DrawKnob(px + 90, py + 42, 13, "X", &guiFdnCross, 200.0f, 8000.0f, fdnColor);
+        }
+
+        // DRIVE Panel: saturacion del master (encendido, curva, oversampling 2x)
+        {
+            int px = 130, py = row3Y, pw = 110;
+            Color driveColor = Color{220, 120, 80, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, driveColor);
+            DrawText("DRIVE", px + 6, py + 4, 10, driveColor);
+
+            const char* labels[] = {guiSatEnabled ? "ON" : "OFF", saturationCurveNames[guiSatCurve],
+                                    guiSatOversample ? "2x" : "1x"};
+            bool lit[] = {guiSatEnabled, guiSatEnabled, guiSatOversample};
+            for (int i = 0; i < 3; i++) {
+                int btnX = px + 5, btnY = py + 18 + i * 16;
+                DrawRectangle(btnX, btnY, 40, 14, lit[i] ? driveColor : Color{45, 45, 55, 255});
+                DrawRectangleLines(btnX, btnY, 40, 14, lit[i] ? WHITE : DARKGRAY);
+                int tw = MeasureText(labels[i], 8);
+                DrawText(labels[i], btnX + (40 - tw) / 2, btnY + 3, 8, lit[i] ? WHITE : GRAY);
+                Vector2 m = GetMousePosition();
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= btnX && m.x <= btnX + 40 && m.y >= btnY && m.y <= btnY + 14) {
+                    if (i == 0) guiSatEnabled = !guiSatEnabled;
+                    if (i == 1) guiSatCurve = (guiSatCurve + 1) % SAT_CURVE_COUNT;
+                    if (i == 2) guiSatOversample = !guiSatOversample;
+                }
+            }
+            DrawKnob(px + 78, py + 42, 13, "Drive", &guiSatDrive, 1.0f, 10.0f, driveColor);
+        }
+
+        // LIMIT Panel: lookahead, techo y release del limitador del master
+        {
+            int px = 245, py = row3Y, pw = 110;
+            Color limitColor = Color{200, 200, 110, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, limitColor);
+            DrawText("LIMIT", px + 6, py + 4, 10, limitColor);
+
+            DrawKnob(px + 20, py + 42, 13, "Look", &guiLimLookahead, 1.0f, 5.0f, limitColor);
+            DrawKnob(px + 55, py + 42, 13, "Ceil", &guiLimCeiling, -12.0f, 0.0f, limitColor);
+            DrawKnob(px + 90, py + 42, 13, "Rel", &guiLimRelease, 10.0f, 500.0f, limitColor);
+        }
+
+        // CHAIN Panel: orden de la cadena de efectos; click en uno lo sube un
+        // lugar (el primero pasa al final). Los que estan en bypass van en gris.
+        {
+            int px = 360, py = row3Y, pw = 110;
+            Color chainColor = Color{120, 160, 220, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, chainColor);
+            DrawText("CHAIN", px + 6, py + 4, 10, chainColor);
+
+            int order[MAX_EFFECT_SLOTS];
+            int count = engine->getEffectOrder(order);
+            for (int i = 0; i < count; i++) {
+                int rowX = px + 5, rowY = py + 17 + i * 10;
+                char text[24];
+                snprintf(text, sizeof(text), "%d %s", i + 1, effectSlotNames[order[i]]);
+                DrawText(text, rowX, rowY, 8, engine->isEffectBypassed(order[i]) ? DARKGRAY : WHITE);
+                Vector2 m = GetMousePosition();
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= rowX && m.x <= px + pw - 5 && m.y >= rowY && m.y < rowY + 10) {
+                    if (i > 0) {
+                        std::swap(order[i - 1], order[i]);
+                    } else {
+                        std::rotate(order, order + 1, order + count);
+                    }
+                    engine->setEffectOrder(order, count);
+                }
+            }
+        }
+
+        // VOICE Panel: paneo base y spread de las notas nuevas
+        {
+            int px = 475, py = row3Y, pw = 75;
+            Color voiceColor = Color{100, 200, 140, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, voiceColor);
+            DrawText("VOICE", px + 6, py + 4, 10, voiceColor);
+
+            // Click en el titulo: modo del spread (por altura o aleatorio)
+            DrawText(spreadModeNames[guiSpreadMode], px + 48, py + 5, 8, WHITE);
+            Vector2 m = GetMousePosition();
+            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= px && m.x <= px + pw && m.y >= py && m.y <= py + 14) {
+                guiSpreadMode = (guiSpreadMode + 1) % SPREAD_MODE_COUNT;
+            }
+
+            DrawKnob(px + 20, py + 42, 13, "Pan", &guiPan, -1.0f, 1.0f, voiceColor);
+            DrawKnob(px + 55, py + 42, 13, "Sprd", &guiSpread, 0.0f, 1.0f, voiceColor);
+        }
+
+        // MATRIX Panel: rutas libres de la matriz de modulacion (fuente,
+        // destino y amount). Click en el titulo cambia de ruta; en fuente y
+        // destino pasa al siguiente.
+        {
+            int px = 555, py = row3Y, pw = 110;
+            Color matrixColor = Color{200, 140, 200, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, matrixColor);
+            DrawText("MATRIX", px + 6, py + 4, 10, matrixColor);
+
+            int r = guiRouteSelected;
+            char routeText[8];
+            snprintf(routeText, sizeof(routeText), "%d/%d", r + 1, GUI_MOD_ROUTES);
+            DrawText(routeText, px + 60, py + 5, 8, WHITE);
+            Vector2 m = GetMousePosition();
+            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= px && m.x <= px + pw && m.y >= py && m.y <= py + 14) {
+                guiRouteSelected = (guiRouteSelected + 1) % GUI_MOD_ROUTES;
+            }
+
+            bool on = guiRouteDest[r] >= 0;
+            const char* labels[] = {modSourceNames[guiRouteSource[r]], on ? modDestinationNames[guiRouteDest[r]] : "Off"};
+            for (int i = 0; i < 2; i++) {
+                int btnX = px + 5, btnY = py + 22 + i * 18;
+                DrawRectangle(btnX, btnY, 50, 14, on ? matrixColor : Color{45, 45, 55, 255});
+                DrawRectangleLines(btnX, btnY, 50, 14, on ? WHITE : DARKGRAY);
+                int tw = MeasureText(labels[i], 8);
+                DrawText(labels[i], btnX + (50 - tw) / 2, btnY + 3, 8, on ? WHITE : GRAY);
+                if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= btnX && m.x <= btnX + 50 && m.y >= btnY && m.y <= btnY + 14) {
+                    if (i == 0) guiRouteSource[r] = (guiRouteSource[r] + 1) % MOD_SRC_COUNT;
+                    if (i == 1) guiRouteDest[r] = guiRouteDest[r] + 1 < MOD_DST_COUNT ? guiRouteDest[r] + 1 : -1;
+                }
+            }
+            DrawKnob(px + 82, py + 42, 13, "Amt", &guiRouteAmount[r], -1.0f, 1.0f, matrixColor);
+        }
+
+        // GLIDE Panel: portamento desde la ultima nota tocada
+        {
+            int px = 670, py = row3Y, pw = 75;
+            Color glideColor = Color{140, 200, 220, 255};
+            DrawRectangle(px, py, pw, row3H, Color{35, 35, 45, 255});
+            DrawRectangleLines(px, py, pw, row3H, glideColor);
+            DrawText("GLIDE", px + 6, py + 4, 10, glideColor);
+
+            // Click en el titulo: tiempo fijo por nota o ms por octava
+            DrawText(glideModeNames[guiGlideMode], px + 48, py + 5, 8, WHITE);
+            Vector2 m = GetMousePosition();
+            if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && m.x >= px && m.x <= px + pw && m.y >= py && m.y <= py + 14) {
+                guiGlideMode = (guiGlideMode + 1) % GLIDE_MODE_COUNT;
+            }
+
+            DrawKnob(px + 37, py + 42, 13, "ms", &guiGlide, 0.0f, 1000.0f, glideColor);
+        }
+
         // ==================== WAVEFORM ====================
-        int waveformY = row2Y + panelH + 5;  // Despues de row2 panels
+        int waveformY = row3Y + row3H + 5;  // Despues de row3 panels
         {
             static float waveData[WAVEFORM_SIZE];
             for (int i = 0; i < WAVEFORM_SIZE; i++) {
@@ -642,7 +816,7 @@ int main() {
             for (int i = 0; i < numWhiteKeys; i++) {
                 int x = keyboardX + i * whiteW;
                 int midiNote = baseMidi + whiteKeyNotes[i];
-                bool pressed = isNoteActive(midiNote);
+                bool pressed = engine->isNoteActive(midiNote);
 
                 Vector2 m = GetMousePosition();
                 if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && m.x >= x && m.x < x + whiteW && m.y >= keyboardY && m.y < keyboardY + whiteH) {
@@ -676,7 +850,7 @@ int main() {
             for (int i = 0; i < 7; i++) {
                 int x = keyboardX + blackPositions[i] * whiteW + whiteW - blackW / 2;
                 int midiNote = baseMidi + blackKeyNotes[i];
-                bool pressed = isNoteActive(midiNote);
+                bool pressed = engine->isNoteActive(midiNote);
 
                 Vector2 m = GetMousePosition();
                 if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && m.x >= x && m.x < x + blackW && m.y >= keyboardY && m.y < keyboardY + blackH) {
@@ -704,13 +878,13 @@ int main() {
         for (int note : activeNotes) {
             bool still = false;
             for (int k : currentKeys) if (k == note) { still = true; break; }
-            if (!still) voiceNoteOff(note);
+            if (!still) engine->noteOff(note);
         }
 
         for (int note : currentKeys) {
             bool was = false;
             for (int a : activeNotes) if (a == note) { was = true; break; }
-            if (!was) voiceNoteOn(note, midiToFreq(note));
+            if (!was) engine->noteOn(note);
         }
 
         activeNotes = currentKeys;
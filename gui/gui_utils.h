@@ -87,7 +87,11 @@ inline void DrawKnob(int cx, int cy, int radius, const char* label, float* value
 }
 
 // Panel de operador FM
+// Click en el titulo: siguiente forma de onda del operador; click derecho:
+// siguiente tabla del banco (bankTableCount 0 = sin banco)
 inline void DrawOperatorPanel(int x, int y, const char* name, float* ratio, float* index,
+                              int* waveform, int waveformCount, const char* waveLabel,
+                              int* bankTable, int bankTableCount,
                               Color color, bool isCarrier, const char* indexLabel) {
     int panelWidth = 70;
     int panelHeight = 115;
@@ -100,7 +104,14 @@ inline void DrawOperatorPanel(int x, int y, const char* name, float* ratio, floa
 
     const char* typeLabel = isCarrier ? "[C]" : "[M]";
     int typeWidth = MeasureText(typeLabel, 9);
-    DrawText(typeLabel, x + (panelWidth - typeWidth) / 2, y + 18, 9, isCarrier ? Color{180, 100, 60, 255} : Color{60, 120, 180, 255});
+    DrawText(typeLabel, x + 6, y + 18, 9, isCarrier ? Color{180, 100, 60, 255} : Color{60, 120, 180, 255});
+
+    DrawText(waveLabel, x + panelWidth - 6 - MeasureText(waveLabel, 9), y + 18, 9, WHITE);
+    Vector2 m = GetMousePosition();
+    if (m.x >= x && m.x <= x + panelWidth && m.y >= y && m.y <= y + 28) {
+        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) *waveform = (*waveform + 1) % waveformCount;
+        if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON) && bankTableCount > 0) *bankTable = (*bankTable + 1) % bankTableCount;
+    }
 
     DrawVerticalSlider(x + 3, y + 30, 55, "R", ratio, 0.5f, 8.0f, color);
     DrawVerticalSlider(x + 36, y + 30, 55, indexLabel, index, 0.0f, 10.0f, color);
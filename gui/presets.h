@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdio>
 #include "../synth/lfo.h"
+#include "../synth/wavetable.h"
 
 const int NUM_PRESETS = 8;
 
@@ -15,8 +16,13 @@ struct Preset {
     float chorus, reverb;
     float lfo1Rate, lfo1Depth, lfo2Rate, lfo2Depth;
     int lfo1Target, lfo2Target;
+    int lfo1Wave, lfo2Wave;
     float modAttack, modDecay, modSustain, modRelease, modAmount;
     int modEnvTarget;
+    int unisonVoices;
+    float unisonDetune;
+    int opWave1, opWave2, opWave3, opWave4;
+    int opTable1, opTable2, opTable3, opTable4;     // tabla del banco con WAVE_BANK
 };
 
 inline void initPresets(Preset* presets) {
@@ -38,10 +44,16 @@ inline void initPresets(Preset* presets) {
         presets[i].lfo1Rate = 2.0f; presets[i].lfo1Depth = 0.0f;
         presets[i].lfo2Rate = 4.0f; presets[i].lfo2Depth = 0.0f;
         presets[i].lfo1Target = LFO_OFF; presets[i].lfo2Target = LFO_OFF;
+        presets[i].lfo1Wave = LFO_SINE; presets[i].lfo2Wave = LFO_SINE;
         presets[i].modAttack = 0.01f; presets[i].modDecay = 0.3f;
         presets[i].modSustain = 0.0f; presets[i].modRelease = 0.2f;
         presets[i].modAmount = 0.0f;
         presets[i].modEnvTarget = MODENV_OFF;
+        presets[i].unisonVoices = 1; presets[i].unisonDetune = 0.0f;
+        presets[i].opWave1 = WAVE_W1; presets[i].opWave2 = WAVE_W1;
+        presets[i].opWave3 = WAVE_W1; presets[i].opWave4 = WAVE_W1;
+        presets[i].opTable1 = 0; presets[i].opTable2 = 0;
+        presets[i].opTable3 = 0; presets[i].opTable4 = 0;
     }
 
     // 0: Init - pure sine wave
@@ -76,6 +88,7 @@ inline void initPresets(Preset* presets) {
     presets[2].algorithm = 0;
     presets[2].lfo1Rate = 5.0f; presets[2].lfo1Depth = 0.15f;
     presets[2].lfo1Target = LFO_INDEX2;
+    presets[2].unisonVoices = 4; presets[2].unisonDetune = 14.0f;
 
     // 3: Pad - Warm Pad
     presets[3].ratio1 = 1.0f; presets[3].ratio2 = 2.0f;
@@ -88,6 +101,7 @@ inline void initPresets(Preset* presets) {
     presets[3].chorus = 0.4f; presets[3].reverb = 0.3f;
     presets[3].lfo1Rate = 0.8f; presets[3].lfo1Depth = 0.1f;
     presets[3].lfo1Target = LFO_INDEX2;
+    presets[3].unisonVoices = 3; presets[3].unisonDetune = 10.0f;
 
     // 4: Keys - E.Piano (DX7 classic)
     presets[4].ratio1 = 1.0f; presets[4].ratio2 = 14.0f;
@@ -137,4 +151,5 @@ inline void initPresets(Preset* presets) {
     presets[7].chorus = 0.5f; presets[7].reverb = 0.25f;
     presets[7].lfo1Rate = 5.5f; presets[7].lfo1Depth = 0.08f;
     presets[7].lfo1Target = LFO_RATIO1;
+    presets[7].unisonVoices = 4; presets[7].unisonDetune = 12.0f;
 }
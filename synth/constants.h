@@ -1,6 +1,17 @@
 #pragma once
 
-const double TWO_PI = 6.28318530717958647692;
-const double SAMPLE_RATE = 44100.0;
+constexpr double TWO_PI = 6.28318530717958647692;
+const double DEFAULT_SAMPLE_RATE = 44100.0;
 const int WAVEFORM_SIZE = 512;
 const int NUM_VOICES = 16;
+const int MAX_BLOCK_SIZE = 512;
+const int CONTROL_BLOCK_SIZE = 32;     // samples por tramo de modulacion (LFOs)
+const int NUM_NOTES = 128;             // notas MIDI
+
+// Tipo de sample del camino de audio. float en produccion;
+// -DFMSYNTH_DOUBLE_PRECISION compila la version de referencia en double.
+#ifdef FMSYNTH_DOUBLE_PRECISION
+typedef double Sample;
+#else
+typedef float Sample;
+#endif
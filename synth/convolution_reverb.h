@@ -0,0 +1,402 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "fft.h"
+#include "semaphore.h"
+#include "wav_reader.h"
+#include "resample.h"
+#include "tail_tracker.h"
+#include "denormals.h"
+#include "effect_chain.h"
+
+// Convolucion particionada uniforme (overlap-save en frecuencia)
+// Cada llamada a process() consume y produce exactamente blockSize samples.
+template <typename T>
+class PartitionedConvolver {
+private:
+    int blockSize;
+    int fftSize;
+    int numBins;
+    int numPartitions;
+    int fdlIndex;
+    FFT<T> fft;
+
+    std::vector<T> irRe, irIm;          // [particion * numBins + bin]
+    std::vector<T> fdlRe, fdlIm;        // espectros de entrada recientes
+    std::vector<T> inputBuffer;         // ultimos 2 * blockSize samples
+    std::vector<T> workRe, workIm;
+
+public:
+    PartitionedConvolver() : blockSize(0), fftSize(0), numBins(0), numPartitions(0), fdlIndex(0) {}
+
+    void init(const T* ir, int length, int block) {
+        blockSize = block;
+        fftSize = block * 2;
+        numBins = block + 1;
+        numPartitions = length > 0 ? (length + block - 1) / block : 0;
+        fdlIndex = 0;
+        fft.init(fftSize);
+
+        irRe.assign((size_t)numPartitions * numBins, 0.0f);
+        irIm.assign((size_t)numPartitions * numBins, 0.0f);
+        fdlRe.assign((size_t)numPartitions * numBins, 0.0f);
+        fdlIm.assign((size_t)numPartitions * numBins, 0.0f);
+        inputBuffer.assign(fftSize, 0.0f);
+        workRe.assign(fftSize, 0.0f);
+        workIm.assign(fftSize, 0.0f);
+
+        for (int p = 0; p < numPartitions; p++) {
+            std::fill(workRe.begin(), workRe.end(), 0.0f);
+            std::fill(workIm.begin(), workIm.end(), 0.0f);
+            int count = std::min(block, length - p * block);
+            std::memcpy(workRe.data(), ir + (size_t)p * block, count * sizeof(T));
+            fft.forward(workRe.data(), workIm.data());
+            std::memcpy(&irRe[(size_t)p * numBins], workRe.data(), numBins * sizeof(T));
+            std::memcpy(&irIm[(size_t)p * numBins], workIm.data(), numBins * sizeof(T));
+        }
+    }
+
+    bool isEmpty() const { return numPartitions == 0; }
+
+    bool isStateZero() const {
+        for (size_t i = 0; i < fdlRe.size(); i++) {
+            if (fdlRe[i] != 0 || fdlIm[i] != 0) return false;
+        }
+        for (T v : inputBuffer) {
+            if (v != 0) return false;
+        }
+        return true;
+    }
+
+    void reset() {
+        std::fill(fdlRe.begin(), fdlRe.end(), 0.0f);
+        std::fill(fdlIm.begin(), fdlIm.end(), 0.0f);
+        std::fill(inputBuffer.begin(), inputBuffer.end(), 0.0f);
+        fdlIndex = 0;
+    }
+
+    void process(const T* input, T* output) {
+        if (numPartitions == 0) {
+            std::fill(output, output + blockSize, 0.0f);
+            return;
+        }
+
+        std::memmove(inputBuffer.data(), inputBuffer.data() + blockSize, blockSize * sizeof(T));
+        std::memcpy(inputBuffer.data() + blockSize, input, blockSize * sizeof(T));
+
+        std::memcpy(workRe.data(), inputBuffer.data(), fftSize * sizeof(T));
+        std::fill(workIm.begin(), workIm.end(), 0.0f);
+        fft.forward(workRe.data(), workIm.data());
+        std::memcpy(&fdlRe[(size_t)fdlIndex * numBins], workRe.data(), numBins * sizeof(T));
+        std::memcpy(&fdlIm[(size_t)fdlIndex * numBins], workIm.data(), numBins * sizeof(T));
+
+        // Entrada real: alcanza con acumular la mitad del espectro
+        T* accRe = workRe.data();
+        T* accIm = workIm.data();
+        std::fill(accRe, accRe + numBins, 0.0f);
+        std::fill(accIm, accIm + numBins, 0.0f);
+        for (int p = 0; p < numPartitions; p++) {
+            int slot = fdlIndex - p;
+            if (slot < 0) slot += numPartitions;
+            const T* xr = &fdlRe[(size_t)slot * numBins];
+            const T* xi = &fdlIm[(size_t)slot * numBins];
+            const T* hr = &irRe[(size_t)p * numBins];
+            const T* hi = &irIm[(size_t)p * numBins];
+            for (int k = 0; k < numBins; k++) {
+                accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+            }
+        }
+        for (int k = numBins; k < fftSize; k++) {
+            accRe[k] = accRe[fftSize - k];
+            accIm[k] = -accIm[fftSize - k];
+        }
+
+        fft.inverse(accRe, accIm);
+        std::memcpy(output, accRe + blockSize, blockSize * sizeof(T));
+
+        fdlIndex = (fdlIndex + 1) % numPartitions;
+    }
+};
+
+// Reverb por convolucion con respuesta al impulso desde un WAV
+// Cabeza FIR directa (latencia cero), particiones chicas en el hilo de audio
+// y particiones grandes para la cola en un hilo de fondo sincronizado por bloque.
+// El hilo de audio nunca espera al de fondo: si un tramo de la cola no llego
+// a tiempo sale en silencio y se cuenta en getLateOverruns().
+template <typename T>
+class ConvolutionReverb : public Effect<T> {
+private:
+    static const int HEAD_SIZE = 64;
+    static const int HEAD_MASK = HEAD_SIZE - 1;
+    static const int EARLY_BLOCK = HEAD_SIZE;
+    static const int LATE_BLOCK = 1024;
+    static const int LATE_START = 2 * LATE_BLOCK;
+    static const int MAX_IR_SECONDS = 10;
+
+    struct Channel {
+        T head[HEAD_SIZE];                  // coeficientes invertidos
+        T headHistory[2 * HEAD_SIZE];
+        PartitionedConvolver<T> early;
+        PartitionedConvolver<T> late;
+        T earlyIn[EARLY_BLOCK];
+        T earlyOut[EARLY_BLOCK];
+        std::vector<T> lateIn, lateOut, jobIn, jobOut;
+    };
+
+    Channel channels[2];
+    int headPos;
+    int earlyPos;
+    int latePos;
+    bool loaded;
+    bool hasLate;
+    bool jobInFlight;
+    double sampleRate;
+    double mix;
+    TailTracker tail;
+
+    // Hilo de fondo: el de audio publica el trabajo con jobPending y lo
+    // despierta con el semaforo (sin locks); el de fondo avisa con jobDone
+    std::thread worker;
+    Semaphore wake;
+    std::atomic<bool> jobPending;
+    std::atomic<bool> quit;
+    std::atomic<bool> jobDone;
+    bool jobResetLate;                  // el trabajo empieza vaciando la cola (lo escribe audio antes de publicar)
+    bool resetLatePending;              // reset() pendiente de pasar al hilo de fondo
+    bool jobStale;                      // el trabajo en curso llega tarde: su salida se descarta
+    std::atomic<int> lateOverruns;
+
+    void workerLoop() {
+        ScopedDenormalGuard denormalGuard;
+        while (true) {
+            wake.wait();
+            if (quit.load(std::memory_order_acquire)) return;
+            if (!jobPending.exchange(false, std::memory_order_acquire)) continue;
+            for (Channel& ch : channels) {
+                if (jobResetLate) ch.late.reset();
+                ch.late.process(ch.jobIn.data(), ch.jobOut.data());
+            }
+            jobDone.store(true, std::memory_order_release);
+        }
+    }
+
+    void stopWorker() {
+        if (!worker.joinable()) return;
+        quit.store(true, std::memory_order_release);
+        wake.post();
+        worker.join();
+        quit.store(false, std::memory_order_relaxed);
+        jobPending.store(false, std::memory_order_relaxed);
+    }
+
+    // Borde de un bloque de la cola: la salida del trabajo anterior se usa
+    // en el bloque que empieza y la entrada que se junto va al hilo de fondo.
+    // Si el trabajo no termino, el bloque de cola sale en silencio y su
+    // entrada se pierde; el que llega tarde se descarta al terminar.
+    void startLateJob() {
+        if (jobInFlight) {
+            if (!jobDone.load(std::memory_order_acquire)) {
+                lateOverruns.fetch_add(1, std::memory_order_relaxed);
+                for (Channel& ch : channels) std::fill(ch.lateOut.begin(), ch.lateOut.end(), 0.0f);
+                jobStale = true;
+                return;
+            }
+            for (Channel& ch : channels) {
+                ch.lateOut.swap(ch.jobOut);
+                if (jobStale) std::fill(ch.lateOut.begin(), ch.lateOut.end(), 0.0f);
+            }
+            jobStale = false;
+            jobInFlight = false;
+        }
+
+        for (Channel& ch : channels) ch.jobIn.swap(ch.lateIn);
+        jobResetLate = resetLatePending;
+        resetLatePending = false;
+        jobDone.store(false, std::memory_order_relaxed);
+        jobPending.store(true, std::memory_order_release);
+        wake.post();
+        jobInFlight = true;
+    }
+
+public:
+    ConvolutionReverb(double sr)
+        : headPos(0), earlyPos(0), latePos(0), loaded(false), hasLate(false), jobInFlight(false),
+          sampleRate(sr), mix(0.0), jobPending(false), quit(false), jobDone(false),
+          jobResetLate(false), resetLatePending(false), jobStale(false), lateOverruns(0) {}
+
+    ~ConvolutionReverb() { stopWorker(); }
+
+    // Vacia todo el estado sin esperar al hilo de fondo: la cola (suya) se
+    // vacia al empezar el proximo trabajo y la salida del que esta en curso
+    // se descarta
+    void reset() {
+        if (jobInFlight) jobStale = true;
+        resetLatePending = true;
+        for (Channel& ch : channels) {
+            std::fill(ch.headHistory, ch.headHistory + 2 * HEAD_SIZE, 0.0f);
+            std::fill(ch.earlyIn, ch.earlyIn + EARLY_BLOCK, 0.0f);
+            std::fill(ch.earlyOut, ch.earlyOut + EARLY_BLOCK, 0.0f);
+            std::fill(ch.lateIn.begin(), ch.lateIn.end(), 0.0f);
+            std::fill(ch.lateOut.begin(), ch.lateOut.end(), 0.0f);
+            ch.early.reset();
+        }
+        headPos = earlyPos = latePos = 0;
+    }
+
+    bool isIdle() const override { return !loaded || tail.isIdle(); }
+
+    void setMix(double m) { mix = m; }
+
+    // Carga la IR desde un WAV; llamar antes de arrancar el stream de audio
+    bool loadImpulseResponse(const char* path) {
+        WavData wav;
+        if (!readWavFile(path, wav)) return false;
+        return setImpulseResponse(wav);
+    }
+
+    // IR ya decodificada (mono o estereo), a cualquier sample rate: se
+    // remuestrea al del motor con sinc enventanado y se normaliza a energia 1
+    bool setImpulseResponse(const WavData& wav) {
+        if (wav.getLength() == 0 || wav.sampleRate <= 0) return false;
+
+        stopWorker();
+        loaded = false;
+
+        const int maxLength = (int)(MAX_IR_SECONDS * sampleRate);
+        std::vector<T> ir[2];
+        double energy = 0.0;
+        for (int c = 0; c < 2; c++) {
+            const std::vector<float>& src = wav.channels[std::min(c, wav.numChannels - 1)];
+            std::vector<float> resampled = resampleWindowedSinc(src, wav.sampleRate, sampleRate, maxLength);
+            ir[c].assign(resampled.begin(), resampled.end());
+            double e = 0.0;
+            for (T v : ir[c]) e += (double)v * v;
+            energy = std::max(energy, e);
+        }
+        if (energy <= 0.0) return false;
+
+        const int length = (int)ir[0].size();
+        const T norm = (T)(1.0 / std::sqrt(energy));
+        hasLate = length > LATE_START;
+        for (int c = 0; c < 2; c++) {
+            Channel& ch = channels[c];
+            for (T& v : ir[c]) v *= norm;
+
+            for (int k = 0; k < HEAD_SIZE; k++) {
+                int tap = HEAD_SIZE - 1 - k;
+                ch.head[k] = tap < length ? ir[c][tap] : 0.0f;
+            }
+            std::fill(ch.headHistory, ch.headHistory + 2 * HEAD_SIZE, 0.0f);
+
+            int earlyLength = std::max(0, std::min(length, LATE_START) - HEAD_SIZE);
+            ch.early.init(ir[c].data() + HEAD_SIZE, earlyLength, EARLY_BLOCK);
+            std::fill(ch.earlyIn, ch.earlyIn + EARLY_BLOCK, 0.0f);
+            std::fill(ch.earlyOut, ch.earlyOut + EARLY_BLOCK, 0.0f);
+
+            int lateLength = hasLate ? length - LATE_START : 0;
+            ch.late.init(hasLate ? ir[c].data() + LATE_START : nullptr, lateLength, LATE_BLOCK);
+            ch.lateIn.assign(LATE_BLOCK, 0.0f);
+            ch.lateOut.assign(LATE_BLOCK, 0.0f);
+            ch.jobIn.assign(LATE_BLOCK, 0.0f);
+            ch.jobOut.assign(LATE_BLOCK, 0.0f);
+        }
+
+        headPos = earlyPos = latePos = 0;
+        jobInFlight = false;
+        jobStale = false;
+        jobResetLate = resetLatePending = false;
+        // Sin feedback: la cola dura lo que la IR mas la latencia del hilo de fondo
+        tail.setTailLength(length + 3 * LATE_BLOCK);
+        if (hasLate) worker = std::thread(&ConvolutionReverb::workerLoop, this);
+        loaded = true;
+        return true;
+    }
+
+    bool isLoaded() const { return loaded; }
+
+    // Historia de la cabeza, buffers y particiones exactamente en cero. La
+    // cola del hilo de fondo cuenta como vacia si tiene un reset pendiente
+    // (se aplica antes de volver a usarla). No llamar con el stream corriendo.
+    bool isStateZero() const {
+        if (!loaded) return true;
+        for (const Channel& ch : channels) {
+            for (int k = 0; k < 2 * HEAD_SIZE; k++) {
+                if (ch.headHistory[k] != 0) return false;
+            }
+            for (int k = 0; k < EARLY_BLOCK; k++) {
+                if (ch.earlyIn[k] != 0 || ch.earlyOut[k] != 0) return false;
+            }
+            if (!ch.early.isStateZero()) return false;
+            if (!hasLate) continue;
+            for (int k = 0; k < LATE_BLOCK; k++) {
+                if (ch.lateIn[k] != 0 || ch.lateOut[k] != 0) return false;
+            }
+            if (!resetLatePending && !ch.late.isStateZero()) return false;
+        }
+        return true;
+    }
+
+    // Bloques de cola que el hilo de fondo no entrego a tiempo
+    int getLateOverruns() const { return lateOverruns.load(std::memory_order_relaxed); }
+
+    // Procesa in-place un bloque estereo
+    void process(T* left, T* right, int numSamples) override {
+        if (!loaded) return;
+        if (mix <= 0.0) {
+            if (!tail.isIdle()) {
+                reset();
+                tail.setIdle();
+            }
+            return;
+        }
+        float inputPeak = std::max(TailTracker::peak(left, numSamples), TailTracker::peak(right, numSamples));
+        if (tail.canSkip(inputPeak)) return;
+
+        const T wetGain = (T)mix;
+        const T dryGain = 1.0f - wetGain;
+        T* io[2] = {left, right};
+
+        for (int n = 0; n < numSamples; n++) {
+            for (int c = 0; c < 2; c++) {
+                Channel& ch = channels[c];
+                const T in = (T)io[c][n];
+
+                ch.headHistory[headPos] = in;
+                ch.headHistory[headPos + HEAD_SIZE] = in;
+                const T* window = ch.headHistory + headPos + 1;
+                T wet = 0.0f;
+                for (int k = 0; k < HEAD_SIZE; k++) {
+                    wet += ch.head[k] * window[k];
+                }
+
+                wet += ch.earlyOut[earlyPos];
+                ch.earlyIn[earlyPos] = in;
+                if (hasLate) {
+                    wet += ch.lateOut[latePos];
+                    ch.lateIn[latePos] = in;
+                }
+
+                io[c][n] = in * dryGain + wet * wetGain;
+            }
+
+            headPos = (headPos + 1) & HEAD_MASK;
+
+            if (++earlyPos == EARLY_BLOCK) {
+                for (Channel& ch : channels) ch.early.process(ch.earlyIn, ch.earlyOut);
+                earlyPos = 0;
+            }
+
+            if (hasLate && ++latePos == LATE_BLOCK) {
+                startLateJob();
+                latePos = 0;
+            }
+        }
+
+        if (tail.update(inputPeak, 0.0f, numSamples)) reset();
+    }
+};
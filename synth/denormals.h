@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FMSYNTH_HAS_MXCSR 1
+#endif
+
+// Umbral por debajo del cual las colas (filtros, reverbs, envolventes) se
+// fuerzan a cero antes de volverse subnormales. Se puede ajustar en runtime.
+inline std::atomic<float> denormalFloor(1e-15f);
+
+inline float getDenormalFloor() { return denormalFloor.load(std::memory_order_relaxed); }
+inline void setDenormalFloor(float floor) { denormalFloor.store(floor, std::memory_order_relaxed); }
+
+inline double flushBelow(double x, double floor) { return std::fabs(x) < floor ? 0.0 : x; }
+inline float flushBelow(float x, float floor) { return std::fabs(x) < floor ? 0.0f : x; }
+
+// Activa flush-to-zero / denormals-are-zero en el hilo actual mientras
+// vive el objeto y restaura el modo anterior al salir del scope.
+class ScopedDenormalGuard {
+private:
+#if defined(FMSYNTH_HAS_MXCSR)
+    unsigned int previous;
+#elif defined(__aarch64__)
+    unsigned long long previous;
+#endif
+
+public:
+    ScopedDenormalGuard() {
+#if defined(FMSYNTH_HAS_MXCSR)
+        previous = _mm_getcsr();
+        _mm_setcsr(previous | 0x8040);      // FTZ (bit 15) + DAZ (bit 6)
+#elif defined(__aarch64__)
+        unsigned long long fpcr;
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+        previous = fpcr;
+        fpcr |= (1ULL << 24);               // FZ
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+#endif
+    }
+
+    ~ScopedDenormalGuard() {
+#if defined(FMSYNTH_HAS_MXCSR)
+        _mm_setcsr(previous);
+#elif defined(__aarch64__)
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(previous));
+#endif
+    }
+
+    ScopedDenormalGuard(const ScopedDenormalGuard&) = delete;
+    ScopedDenormalGuard& operator=(const ScopedDenormalGuard&) = delete;
+};
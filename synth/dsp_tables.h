@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include "constants.h"
+
+// Tablas de DSP generadas en tiempo de compilacion (seno, exp2, MIDI a Hz).
+// Son variables inline constexpr: quedan en datos de solo lectura, no hay
+// inicializacion al arrancar y todas las instancias comparten una copia.
+// El tamano y el tipo de cada tabla son parametros del template.
+
+const int SINE_TABLE_SIZE = 4096;       // error de la interpolacion lineal < 3e-7
+const int EXP2_TABLE_SIZE = 1024;       // error relativo < 1e-7
+
+namespace dsp_tables {
+
+constexpr double PI = TWO_PI * 0.5;
+constexpr double LN2 = 0.69314718055994530942;
+
+// Serie de Taylor de sin en [-pi/2, pi/2]; hasta x^25 sobra para double
+constexpr double sinSeries(double x) {
+    double term = x;
+    double sum = x;
+    for (int k = 1; k <= 12; k++) {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double sin(double x) {
+    while (x > PI) x -= TWO_PI;
+    while (x < -PI) x += TWO_PI;
+    if (x > PI * 0.5) x = PI - x;
+    if (x < -PI * 0.5) x = -PI - x;
+    return sinSeries(x);
+}
+
+// 2^x: la parte entera por multiplicaciones exactas, la fraccion por Taylor
+constexpr double exp2(double x) {
+    double scale = 1.0;
+    while (x >= 1.0) { x -= 1.0; scale *= 2.0; }
+    while (x < 0.0) { x += 1.0; scale *= 0.5; }
+    double y = x * LN2;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; k <= 20; k++) {
+        term *= y / k;
+        sum += term;
+    }
+    return scale * sum;
+}
+
+constexpr double abs(double x) { return x < 0.0 ? -x : x; }
+
+// Un ciclo de seno con un punto de guarda al final para interpolar sin mascara
+template <typename T, int N>
+constexpr std::array<T, N + 1> makeSineTable() {
+    std::array<T, N + 1> table{};
+    for (int i = 0; i <= N; i++) table[i] = (T)sin(TWO_PI * i / N);
+    return table;
+}
+
+// 2^x para x en [0, 1] (N + 1 puntos)
+template <typename T, int N>
+constexpr std::array<T, N + 1> makeExp2Table() {
+    std::array<T, N + 1> table{};
+    for (int i = 0; i <= N; i++) table[i] = (T)exp2((double)i / N);
+    return table;
+}
+
+// Temperamento igual, A4 (nota 69) = 440 Hz
+template <typename T>
+constexpr std::array<T, NUM_NOTES> makeMidiFrequencyTable() {
+    std::array<T, NUM_NOTES> table{};
+    for (int n = 0; n < NUM_NOTES; n++) table[n] = (T)(440.0 * exp2((n - 69) / 12.0));
+    return table;
+}
+
+} // namespace dsp_tables
+
+template <typename T>
+inline constexpr std::array<T, SINE_TABLE_SIZE + 1> sineTable = dsp_tables::makeSineTable<T, SINE_TABLE_SIZE>();
+
+template <typename T>
+inline constexpr std::array<T, EXP2_TABLE_SIZE + 1> exp2Table = dsp_tables::makeExp2Table<T, EXP2_TABLE_SIZE>();
+
+template <typename T>
+inline constexpr std::array<T, NUM_NOTES> midiFrequencyTable = dsp_tables::makeMidiFrequencyTable<T>();
+
+static_assert((SINE_TABLE_SIZE & (SINE_TABLE_SIZE - 1)) == 0, "SINE_TABLE_SIZE tiene que ser potencia de 2");
+static_assert(sineTable<double>[0] == 0.0, "sin(0)");
+static_assert(dsp_tables::abs(sineTable<double>[SINE_TABLE_SIZE / 4] - 1.0) < 1e-12, "sin(pi/2)");
+static_assert(dsp_tables::abs(sineTable<double>[SINE_TABLE_SIZE / 2]) < 1e-12, "sin(pi)");
+static_assert(dsp_tables::abs(sineTable<double>[3 * SINE_TABLE_SIZE / 4] + 1.0) < 1e-12, "sin(3pi/2)");
+static_assert(dsp_tables::abs(sineTable<double>[SINE_TABLE_SIZE]) < 1e-12, "punto de guarda");
+static_assert(exp2Table<double>[0] == 1.0, "2^0");
+static_assert(dsp_tables::abs(exp2Table<double>[EXP2_TABLE_SIZE] - 2.0) < 1e-12, "2^1");
+static_assert(midiFrequencyTable<double>[69] == 440.0, "A4");
+static_assert(dsp_tables::abs(midiFrequencyTable<double>[81] - 880.0) < 1e-9, "A5");
+static_assert(dsp_tables::abs(midiFrequencyTable<double>[60] - 261.6255653005986) < 1e-9, "C4");
+
+// Seno por tabla con interpolacion lineal; x en radianes, cualquier signo
+template <typename T>
+inline T tableSin(T x) {
+    const T position = x * (T)(SINE_TABLE_SIZE / TWO_PI);
+    int i = (int)position;
+    if (position < (T)i) i--;           // floor sin llamar a libm
+    const T frac = position - (T)i;
+    const T* t = sineTable<T>.data() + (i & (SINE_TABLE_SIZE - 1));
+    return t[0] + frac * (t[1] - t[0]);
+}
+
+// 2^x por tabla: la parte entera va al exponente con ldexp
+inline double tableExp2(double x) {
+    const double whole = std::floor(x);
+    const double position = (x - whole) * EXP2_TABLE_SIZE;
+    const int i = (int)position;
+    const double frac = position - i;
+    const double* t = exp2Table<double>.data() + i;
+    return std::ldexp(t[0] + frac * (t[1] - t[0]), (int)whole);
+}
+
+// Conversiones de uso comun sobre la tabla exponencial
+inline double dbToGain(double db) { return tableExp2(db * 0.16609640474436813); }     // log2(10) / 20
+inline double semitonesToRatio(double semitones) { return tableExp2(semitones / 12.0); }
+
+// e^-x: coeficientes de envolventes y seguidores exponenciales de un polo
+inline double exponentialDecay(double x) { return tableExp2(-x * 1.4426950408889634); }   // log2(e)
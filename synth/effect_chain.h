@@ -0,0 +1,98 @@
+#pragma once
+#include "triple_buffer.h"
+
+const int MAX_EFFECT_SLOTS = 8;
+
+// Interfaz comun de los efectos del master: bloque estereo planar in-place
+template <typename T>
+class Effect {
+public:
+    virtual ~Effect() {}
+    virtual void process(T* left, T* right, int numSamples) = 0;
+    virtual bool isIdle() const = 0;
+};
+
+// Cadena de efectos reordenable.
+// El hilo de control edita orden y bypass y publica una lista compilada de
+// slots activos por triple buffer; el hilo de audio toma la ultima lista al
+// principio de cada bloque sin locks. Los slots en bypass no estan en la
+// lista, asi que no cuestan ni una llamada.
+template <typename T>
+class EffectChain {
+private:
+    struct CompiledOrder {
+        int slots[MAX_EFFECT_SLOTS];
+        int count;
+    };
+
+    Effect<T>* effects[MAX_EFFECT_SLOTS];
+    TripleBuffer<CompiledOrder> orders;
+
+    // Estado del hilo de control
+    int order[MAX_EFFECT_SLOTS];
+    int orderCount;
+    bool bypass[MAX_EFFECT_SLOTS];
+
+    void publish() {
+        CompiledOrder& o = orders.writeBuffer();
+        o.count = 0;
+        for (int i = 0; i < orderCount; i++) {
+            int id = order[i];
+            if (!bypass[id] && effects[id]) o.slots[o.count++] = id;
+        }
+        orders.publish();
+    }
+
+public:
+    EffectChain() : orderCount(0) {
+        for (int i = 0; i < MAX_EFFECT_SLOTS; i++) {
+            effects[i] = nullptr;
+            bypass[i] = false;
+        }
+    }
+
+    // Registrar un efecto en un slot; no llamar con el stream corriendo
+    void setSlot(int id, Effect<T>* effect) {
+        effects[id] = effect;
+        publish();
+    }
+
+    // Orden de procesamiento por id de slot (los que no aparecen no suenan)
+    void setOrder(const int* ids, int count) {
+        orderCount = 0;
+        for (int i = 0; i < count && orderCount < MAX_EFFECT_SLOTS; i++) {
+            if (ids[i] >= 0 && ids[i] < MAX_EFFECT_SLOTS) order[orderCount++] = ids[i];
+        }
+        publish();
+    }
+
+    int getOrder(int* ids) const {
+        for (int i = 0; i < orderCount; i++) ids[i] = order[i];
+        return orderCount;
+    }
+
+    void setBypass(int id, bool bypassed) {
+        if (bypass[id] == bypassed) return;
+        bypass[id] = bypassed;
+        publish();
+    }
+
+    bool isBypassed(int id) const { return bypass[id]; }
+
+    // Hilo de audio
+    void process(T* left, T* right, int numSamples) {
+        const CompiledOrder& o = orders.read();
+        for (int i = 0; i < o.count; i++) {
+            effects[o.slots[i]]->process(left, right, numSamples);
+        }
+    }
+
+    // Hilo de audio: true si todos los slots activos estan inactivos
+    bool isIdle() {
+        const CompiledOrder& o = orders.read();
+        for (int i = 0; i < o.count; i++) {
+            if (!effects[o.slots[i]]->isIdle()) return false;
+        }
+        return true;
+    }
+};
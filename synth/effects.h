@@ -1,17 +1,43 @@
 #pragma once
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include "tail_tracker.h"
+#include "denormals.h"
+#include "effect_chain.h"
+
+enum ReverbType {
+    REVERB_SCHROEDER = 0,
+    REVERB_FDN,
+    REVERB_CONVOLUTION,
+    REVERB_TYPE_COUNT
+};
+
+inline const char* reverbTypeNames[] = {
+    "SCH", "FDN", "CNV"
+};
 
 // Chorus estilo Juno-106
-class JunoChorus {
+// Procesa por bloques: una sola linea de retardo compartida por los dos taps,
+// LFOs con oscilador recursivo (rotacion de fasor) y ambos canales en una pasada.
+// La linea se alimenta con la suma mono (L + R) / 2; el seco conserva el estereo.
+template <typename T>
+class JunoChorus : public Effect<T> {
 private:
-    static const int MAX_DELAY = 2048;
-    std::vector<double> delayLineL;
-    std::vector<double> delayLineR;
+    std::vector<T> delayLine;
+    int delaySize;                      // potencia de dos segun el sample rate
+    int delayMask;
     int writeIndex;
-    double lfoPhase1;
-    double lfoPhase2;
     double sampleRate;
+    double mix;
+
+    // Lane 0 = L, lane 1 = R (LFO2 arranca desfasado 90 grados)
+    T lfoSin[2];
+    T lfoCos[2];
+    T rotSin[2];
+    T rotCos[2];
+
+    TailTracker tail;
 
     const double lfoRate1 = 0.513;
     const double lfoRate2 = 0.863;
@@ -19,118 +45,248 @@ private:
     const double depth = 0.003;
 
 public:
-    JunoChorus(double sr) : sampleRate(sr), writeIndex(0), lfoPhase1(0), lfoPhase2(0) {
-        delayLineL.resize(MAX_DELAY, 0.0);
-        delayLineR.resize(MAX_DELAY, 0.0);
+    JunoChorus(double sr) : writeIndex(0), sampleRate(sr), mix(0.0) {
+        int maxDelay = (int)((baseDelay + depth) * sampleRate) + 2;
+        delaySize = 1;
+        while (delaySize < maxDelay) delaySize <<= 1;
+        delayMask = delaySize - 1;
+        delayLine.assign(delaySize, 0.0f);
+        tail.setTailLength(delaySize);
+
+        const double rates[2] = {lfoRate1, lfoRate2};
+        const double phases[2] = {0.0, 1.5708};
+        for (int c = 0; c < 2; c++) {
+            double w = 2.0 * 3.14159265 * rates[c] / sampleRate;
+            rotSin[c] = (T)std::sin(w);
+            rotCos[c] = (T)std::cos(w);
+            lfoSin[c] = (T)std::sin(phases[c]);
+            lfoCos[c] = (T)std::cos(phases[c]);
+        }
     }
 
-    void process(double input, double& outL, double& outR, double mix) {
-        delayLineL[writeIndex] = input;
-        delayLineR[writeIndex] = input;
+    void setMix(double m) { mix = m; }
 
-        double lfo1 = std::sin(lfoPhase1 * 2.0 * 3.14159265);
-        double lfo2 = std::sin(lfoPhase2 * 2.0 * 3.14159265 + 1.5708);
+    void process(T* left, T* right, int numSamples) override {
+        // Sin senal y con la linea ya vacia no hay nada que hacer
+        float inputPeak = std::max(TailTracker::peak(left, numSamples), TailTracker::peak(right, numSamples));
+        if (tail.canSkip(inputPeak)) return;
 
-        double delayTimeL = baseDelay + depth * lfo1;
-        double delayTimeR = baseDelay + depth * lfo2;
+        if (mix <= 0.0) {
+            // Seguir llenando la linea para que al subir el mix no haya basura
+            for (int i = 0; i < numSamples; i++) {
+                delayLine[writeIndex] = (left[i] + right[i]) * (T)0.5;
+                writeIndex = (writeIndex + 1) & delayMask;
+            }
+            tail.update(inputPeak, 0.0f, numSamples);
+            return;
+        }
 
-        double delaySamplesL = delayTimeL * sampleRate;
-        double delaySamplesR = delayTimeR * sampleRate;
+        const T baseSamples = (T)(baseDelay * sampleRate);
+        const T depthSamples = (T)(depth * sampleRate);
+        const T wetGain = (T)mix;
+        const T dryGain = 1.0f - wetGain;
+        const T* line = delayLine.data();
 
-        double readPosL = writeIndex - delaySamplesL;
-        double readPosR = writeIndex - delaySamplesR;
-        if (readPosL < 0) readPosL += MAX_DELAY;
-        if (readPosR < 0) readPosR += MAX_DELAY;
+        for (int i = 0; i < numSamples; i++) {
+            delayLine[writeIndex] = (left[i] + right[i]) * (T)0.5;
 
-        int indexL = (int)readPosL;
-        int indexL2 = (indexL + 1) % MAX_DELAY;
-        double fracL = readPosL - indexL;
+            T wet[2];
+            for (int c = 0; c < 2; c++) {
+                T readPos = (T)(writeIndex + delaySize) - (baseSamples + depthSamples * lfoSin[c]);
+                int idx = (int)readPos;
+                T frac = readPos - (T)idx;
+                T a = line[idx & delayMask];
+                T b = line[(idx + 1) & delayMask];
+                wet[c] = a + (b - a) * frac;
 
-        int indexR = (int)readPosR;
-        int indexR2 = (indexR + 1) % MAX_DELAY;
-        double fracR = readPosR - indexR;
+                T s = lfoSin[c] * rotCos[c] + lfoCos[c] * rotSin[c];
+                T k = lfoCos[c] * rotCos[c] - lfoSin[c] * rotSin[c];
+                lfoSin[c] = s;
+                lfoCos[c] = k;
+            }
 
-        double wetL = delayLineL[indexL] * (1.0 - fracL) + delayLineL[indexL2] * fracL;
-        double wetR = delayLineR[indexR] * (1.0 - fracR) + delayLineR[indexR2] * fracR;
+            left[i] = left[i] * dryGain + wet[0] * wetGain;
+            right[i] = right[i] * dryGain + wet[1] * wetGain;
 
-        outL = input * (1.0 - mix) + wetL * mix;
-        outR = input * (1.0 - mix) + wetR * mix;
+            writeIndex = (writeIndex + 1) & delayMask;
+        }
 
-        lfoPhase1 += lfoRate1 / sampleRate;
-        lfoPhase2 += lfoRate2 / sampleRate;
-        if (lfoPhase1 >= 1.0) lfoPhase1 -= 1.0;
-        if (lfoPhase2 >= 1.0) lfoPhase2 -= 1.0;
+        // Renormalizar los fasores una vez por bloque para que no deriven
+        for (int c = 0; c < 2; c++) {
+            T mag = std::sqrt(lfoSin[c] * lfoSin[c] + lfoCos[c] * lfoCos[c]);
+            lfoSin[c] /= mag;
+            lfoCos[c] /= mag;
+        }
 
-        writeIndex = (writeIndex + 1) % MAX_DELAY;
+        if (tail.update(inputPeak, 0.0f, numSamples)) {
+            std::fill(delayLine.begin(), delayLine.end(), 0.0f);
+        }
     }
+
+    bool isIdle() const override { return tail.isIdle(); }
 };
 
-// Reverb atmosferica (Schroeder)
-class AtmosphericReverb {
+// Reverb atmosferica (Schroeder) true-stereo
+// Los 8 combs (4 por canal, largos decorrelacionados L/R) comparten un unico
+// buffer contiguo intercalado por lane e indice de escritura con mascara.
+template <typename T>
+class AtmosphericReverb : public Effect<T> {
 private:
     static const int NUM_COMBS = 4;
-    std::vector<std::vector<double>> combBuffers;
-    std::vector<int> combDelays;
-    std::vector<int> combIndices;
-    std::vector<double> combFilters;
-
+    static const int NUM_LANES = NUM_COMBS * 2;     // 0-3 = L, 4-7 = R
     static const int NUM_ALLPASS = 2;
-    std::vector<std::vector<double>> allpassBuffers;
-    std::vector<int> allpassDelays;
-    std::vector<int> allpassIndices;
+    static const int STEREO_SPREAD = 23;
+
+    std::vector<T> combMemory;          // [pos * NUM_LANES + lane]
+    int combDelays[NUM_LANES];
+    T combFilters[NUM_LANES];
+    int combMask;
+    int combIndex;
+
+    std::vector<T> allpassMemory;       // [(stage * size + pos) * 2 + canal]
+    int allpassDelays[NUM_ALLPASS][2];
+    int allpassSize;
+    int allpassMask;
+    int allpassIndex;
 
     double decay;
     double damping;
     double sampleRate;
+    double mix;
+
+    TailTracker tail;
+
+    static int nextPowerOfTwo(int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
 
 public:
-    AtmosphericReverb(double sr) : sampleRate(sr), decay(0.85), damping(0.3) {
-        combDelays = {1687, 1931, 2053, 2251};
-        allpassDelays = {547, 331};
+    AtmosphericReverb(double sr) : combIndex(0), allpassIndex(0), decay(0.85), damping(0.3), sampleRate(sr), mix(0.0) {
+        const int baseCombs[NUM_COMBS] = {1687, 1931, 2053, 2251};
+        const int baseAllpass[NUM_ALLPASS] = {547, 331};
 
         double srRatio = sr / 44100.0;
-        for (auto& d : combDelays) d = (int)(d * srRatio);
-        for (auto& d : allpassDelays) d = (int)(d * srRatio);
-
-        combBuffers.resize(NUM_COMBS);
-        combIndices.resize(NUM_COMBS, 0);
-        combFilters.resize(NUM_COMBS, 0.0);
+        int maxComb = 0;
         for (int i = 0; i < NUM_COMBS; i++) {
-            combBuffers[i].resize(combDelays[i], 0.0);
+            combDelays[i] = (int)(baseCombs[i] * srRatio);
+            combDelays[i + NUM_COMBS] = (int)((baseCombs[i] + STEREO_SPREAD) * srRatio);
+            maxComb = std::max(maxComb, combDelays[i + NUM_COMBS]);
         }
-
-        allpassBuffers.resize(NUM_ALLPASS);
-        allpassIndices.resize(NUM_ALLPASS, 0);
+        int maxAllpass = 0;
         for (int i = 0; i < NUM_ALLPASS; i++) {
-            allpassBuffers[i].resize(allpassDelays[i], 0.0);
+            allpassDelays[i][0] = (int)(baseAllpass[i] * srRatio);
+            allpassDelays[i][1] = (int)((baseAllpass[i] + STEREO_SPREAD) * srRatio);
+            maxAllpass = std::max(maxAllpass, allpassDelays[i][1]);
         }
+
+        int combSize = nextPowerOfTwo(maxComb + 1);
+        combMask = combSize - 1;
+        combMemory.assign((size_t)combSize * NUM_LANES, 0.0f);
+        for (int i = 0; i < NUM_LANES; i++) combFilters[i] = 0.0f;
+
+        allpassSize = nextPowerOfTwo(maxAllpass + 1);
+        allpassMask = allpassSize - 1;
+        allpassMemory.assign((size_t)allpassSize * NUM_ALLPASS * 2, 0.0f);
+        tail.setTailLength(maxComb + maxAllpass * NUM_ALLPASS);
     }
 
-    double process(double input, double mix) {
-        double wet = 0.0;
+    void reset() {
+        std::fill(combMemory.begin(), combMemory.end(), 0.0f);
+        std::fill(allpassMemory.begin(), allpassMemory.end(), 0.0f);
+        for (int i = 0; i < NUM_LANES; i++) combFilters[i] = 0.0f;
+    }
 
-        for (int i = 0; i < NUM_COMBS; i++) {
-            int idx = combIndices[i];
-            double delayed = combBuffers[i][idx];
-            combFilters[i] = delayed * (1.0 - damping) + combFilters[i] * damping;
-            double feedback = combFilters[i] * decay;
-            combBuffers[i][idx] = input + feedback;
-            wet += delayed;
-            combIndices[i] = (idx + 1) % combDelays[i];
+    bool isIdle() const override { return tail.isIdle(); }
+
+    void setMix(double m) { mix = m; }
+
+    // Combs, allpass y filtros de los combs exactamente en cero (recorre toda la memoria)
+    bool isStateZero() const {
+        for (int i = 0; i < NUM_LANES; i++) {
+            if (combFilters[i] != 0) return false;
+        }
+        for (T v : combMemory) {
+            if (v != 0) return false;
         }
+        for (T v : allpassMemory) {
+            if (v != 0) return false;
+        }
+        return true;
+    }
 
-        wet *= 0.25;
+    // Procesa in-place un bloque estereo
+    void process(T* left, T* right, int numSamples) override {
+        if (mix <= 0.0) {
+            // La cola no se escucha: se descarta y el reverb queda inactivo
+            if (!tail.isIdle()) {
+                reset();
+                tail.setIdle();
+            }
+            return;
+        }
+        float inputPeak = std::max(TailTracker::peak(left, numSamples), TailTracker::peak(right, numSamples));
+        if (tail.canSkip(inputPeak)) return;
 
-        for (int i = 0; i < NUM_ALLPASS; i++) {
-            int idx = allpassIndices[i];
-            double delayed = allpassBuffers[i][idx];
-            double g = 0.5;
-            double output = -g * wet + delayed;
-            allpassBuffers[i][idx] = wet + g * output;
-            wet = output;
-            allpassIndices[i] = (idx + 1) % allpassDelays[i];
+        const T fb = (T)decay;
+        const T damp = (T)damping;
+        const T wetGain = (T)mix;
+        const T dryGain = 1.0f - wetGain;
+        const T g = 0.5f;
+        T* comb = combMemory.data();
+        T* ap = allpassMemory.data();
+        T statePeak = 0.0f;
+
+        for (int n = 0; n < numSamples; n++) {
+            const T inL = (T)left[n];
+            const T inR = (T)right[n];
+
+            T in[NUM_LANES];
+            T delayed[NUM_LANES];
+            for (int i = 0; i < NUM_LANES; i++) {
+                in[i] = i < NUM_COMBS ? inL : inR;
+            }
+
+            T* writeRow = comb + (size_t)(combIndex & combMask) * NUM_LANES;
+            for (int i = 0; i < NUM_LANES; i++) {
+                delayed[i] = comb[(size_t)((combIndex - combDelays[i]) & combMask) * NUM_LANES + i];
+            }
+            for (int i = 0; i < NUM_LANES; i++) {
+                combFilters[i] = delayed[i] * (1.0f - damp) + combFilters[i] * damp;
+                writeRow[i] = in[i] + combFilters[i] * fb;
+                statePeak = std::max(statePeak, std::fabs(writeRow[i]));
+            }
+            combIndex = (combIndex + 1) & combMask;
+
+            T wet[2] = {0.0f, 0.0f};
+            for (int i = 0; i < NUM_COMBS; i++) {
+                wet[0] += delayed[i];
+                wet[1] += delayed[i + NUM_COMBS];
+            }
+            wet[0] *= 0.25f;
+            wet[1] *= 0.25f;
+
+            for (int s = 0; s < NUM_ALLPASS; s++) {
+                T* stage = ap + (size_t)s * allpassSize * 2;
+                for (int c = 0; c < 2; c++) {
+                    T d = stage[(size_t)((allpassIndex - allpassDelays[s][c]) & allpassMask) * 2 + c];
+                    T output = -g * wet[c] + d;
+                    T stored = wet[c] + g * output;
+                    stage[(size_t)(allpassIndex & allpassMask) * 2 + c] = stored;
+                    statePeak = std::max(statePeak, std::fabs(stored));
+                    wet[c] = output;
+                }
+            }
+            allpassIndex = (allpassIndex + 1) & allpassMask;
+
+            left[n] = inL * dryGain + wet[0] * wetGain;
+            right[n] = inR * dryGain + wet[1] * wetGain;
         }
 
-        return input * (1.0 - mix) + wet * mix;
+        const T floor = getDenormalFloor();
+        for (int i = 0; i < NUM_LANES; i++) combFilters[i] = flushBelow(combFilters[i], floor);
+
+        if (tail.update(inputPeak, statePeak, numSamples)) reset();
     }
 };
@@ -0,0 +1,902 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include "constants.h"
+#include "dsp_tables.h"
+#include "denormals.h"
+#include "filter.h"
+#include "effects.h"
+#include "fdn_reverb.h"
+#include "convolution_reverb.h"
+#include "saturator.h"
+#include "limiter.h"
+#include "fm_synth.h"
+#include "voice.h"
+#include "effect_chain.h"
+#include "lfo.h"
+#include "mod_matrix.h"
+#include "note_table.h"
+#include "tuning.h"
+#include "triple_buffer.h"
+#include "spsc_queue.h"
+#include "wavetable.h"
+#include "wavetable_bank.h"
+
+// Slots de la cadena de efectos del master
+enum EffectSlot {
+    FX_FILTER = 0,
+    FX_CHORUS,
+    FX_REVERB_SCHROEDER,
+    FX_REVERB_FDN,
+    FX_REVERB_CONVOLUTION,
+    FX_SLOT_COUNT
+};
+
+inline const char* effectSlotNames[] = {
+    "Filter", "Chorus", "Reverb", "FDN", "Conv"
+};
+
+// Slots de la matriz de modulacion: LFOs, mod env y despues las rutas libres
+const int MOD_ROUTE_MOD_ENV = NUM_LFOS;
+const int MOD_ROUTE_USER = NUM_LFOS + 1;
+const int MOD_USER_ROUTES = MAX_MOD_ROUTES - MOD_ROUTE_USER;
+
+// Lanes de expresion por nota (MPE); bend -1 a 1, pressure y slide 0 a 1
+enum ExpressionLane {
+    EXPR_PITCH_BEND = 0,
+    EXPR_PRESSURE,
+    EXPR_SLIDE,
+    EXPR_LANE_COUNT
+};
+
+// Portamento: tiempo fijo por nota o velocidad constante (ms por octava)
+enum GlideMode {
+    GLIDE_TIME = 0,
+    GLIDE_RATE,
+    GLIDE_MODE_COUNT
+};
+
+inline const char* glideModeNames[] = {
+    "Time", "Rate"
+};
+
+// Como se reparte el spread estereo entre las notas
+enum SpreadMode {
+    SPREAD_KEY = 0,     // por altura: graves a la izquierda, agudos a la derecha
+    SPREAD_RANDOM,      // posicion aleatoria en cada nota
+    SPREAD_MODE_COUNT
+};
+
+inline const char* spreadModeNames[] = {
+    "Key", "Rand"
+};
+
+// Motor de audio: voces + efectos del bus master.
+// Todo lo que depende del sample rate (incrementos de fase, envolventes,
+// coeficientes y lineas de retardo) se reconstruye en prepare().
+// T es el tipo de sample de todo el camino de audio (ver Sample en constants.h).
+template <typename T>
+class SynthEngine {
+private:
+    Voice<T> voices[NUM_VOICES];
+    std::unique_ptr<Filter<T>> filter;
+    std::unique_ptr<JunoChorus<T>> chorus;
+    std::unique_ptr<AtmosphericReverb<T>> reverb;
+    std::unique_ptr<FDNReverb<T>> fdnReverb;
+    std::unique_ptr<ConvolutionReverb<T>> convolutionReverb;
+    EffectChain<T> effectChain;
+    Saturator<T> saturators[2];
+    std::unique_ptr<DCBlocker<T>> dcBlockers[2];
+    std::unique_ptr<LookaheadLimiter<T>> limiter;
+    int masterDrain;                    // samples de silencio que faltan para vaciar el master
+    std::string impulseResponsePath;
+    double sampleRate;
+
+    std::atomic<double> chorusMix;
+    std::atomic<double> reverbMix;
+    std::atomic<double> fdnDecayLow;
+    std::atomic<double> fdnDecayHigh;
+    std::atomic<double> fdnCrossover;
+    std::atomic<double> voicePan;
+    std::atomic<double> voiceSpread;
+    std::atomic<int> spreadMode;
+    unsigned int spreadSeed;
+    std::atomic<bool> saturationEnabled;
+    std::atomic<int> saturationCurve;
+    std::atomic<double> saturationDrive;
+    std::atomic<bool> saturationOversampling;
+    std::atomic<double> limiterLookahead;
+    std::atomic<double> limiterCeiling;
+    std::atomic<double> limiterRelease;
+
+    // Filtro: los coeficientes se calculan en el hilo de audio (el LFO puede moverlos)
+    std::atomic<int> filterType;
+    std::atomic<double> filterCutoff;
+    std::atomic<double> filterQ;
+    double appliedCutoff;
+    double appliedQ;
+    int appliedFilterType;
+    double appliedFdnDecay[3];          // graves, agudos y cruce aplicados a la FDN
+    std::atomic<int> lastVoice;         // la ultima nota modula los destinos del master
+
+    // LFOs: globales (uno para todas las voces) o uno por voz
+    std::atomic<double> lfoRate[NUM_LFOS];
+    std::atomic<int> lfoWaveform[NUM_LFOS];
+    std::atomic<bool> lfoPerVoice[NUM_LFOS];
+    std::atomic<bool> lfoKeySync[NUM_LFOS];
+    LFO globalLfo[NUM_LFOS];
+    double globalLfoValue[NUM_LFOS][MAX_BLOCK_SIZE / CONTROL_BLOCK_SIZE];
+
+    // Matriz de modulacion: los paneles de LFO y mod env usan los primeros slots
+    ModMatrix modMatrix;
+    std::atomic<double> modWheel;
+    std::atomic<double> aftertouch;
+    double modSources[MOD_SRC_COUNT][MOD_COLUMNS];
+    double modOffsets[MOD_DST_COUNT][MOD_COLUMNS];
+
+    // Expresion por nota en SoA [lane][voz]: los eventos fijan el objetivo y
+    // el audio lo suaviza con un polo por tramo de control. Una voz nueva
+    // arranca en el objetivo sin suavizar (la expresion inicial de MPE llega
+    // justo despues del note on).
+    double expressionTarget[EXPR_LANE_COUNT][NUM_VOICES];
+    bool expressionSnap[NUM_VOICES];
+    double expression[EXPR_LANE_COUNT][NUM_VOICES];
+    double expressionCoeff;
+    std::atomic<double> pitchBend;      // bend global en semitonos
+    std::atomic<double> noteBendRange;  // semitonos del bend por nota a fondo
+
+    std::atomic<int> glideMode;
+    std::atomic<double> glideTime;      // ms (GLIDE_TIME) o ms por octava (GLIDE_RATE); 0 = apagado
+    double lastNoteFrequency;           // origen del portamento de la nota siguiente
+
+    // Tabla de notas del patch y la afinacion. Se compila al cambiar el
+    // escalado o la escala y se publica por triple buffer: cargar un .scl
+    // nunca deja a un noteOn leyendo una tabla a medio escribir.
+    KeyScaling keyScaling;
+    Tuning tuning;
+    TripleBuffer<NoteTable> noteTable;
+
+    // Eventos de nota: el control los encola y el audio los aplica al
+    // principio de cada bloque, asi la asignacion de voces y el noteOn de
+    // FMSynth nunca corren a mitad de un render. Hay un solo productor: el
+    // hilo que toca las notas (la GUI o la entrada MIDI, no las dos).
+    enum NoteEventType { NOTE_EVENT_ON, NOTE_EVENT_OFF, NOTE_EVENT_EXPRESSION };
+    struct NoteEvent {
+        int type;
+        int note;
+        int channel;
+        int lane;
+        double value;       // velocity o valor de la expresion
+    };
+    static const int NOTE_QUEUE_SIZE = 1024;
+    SpscQueue<NoteEvent, NOTE_QUEUE_SIZE> noteEvents;
+    std::atomic<int> voiceNote[NUM_VOICES];     // copia de voices[].note para la GUI
+
+    void publishNoteTable() {
+        noteTable.writeBuffer().build(keyScaling, tuning);
+        noteTable.publish();
+    }
+
+    // Formas de onda de los operadores. Al cargar otra tabla de usuario u
+    // otro banco el anterior se retira: una voz puede seguir leyendolo hasta
+    // que termina el render en curso, y recien despues se libera (en el hilo
+    // de control, con collectRetiredTables()).
+    struct LoadedBank {
+        std::shared_ptr<const WavetableBank> bank;          // mapeo compartido entre motores
+        std::vector<std::unique_ptr<Wavetable<T>>> tables;
+    };
+
+    struct RetiredTables {
+        uint64_t renders;                   // renderCount al retirarlas
+        std::shared_ptr<const void> tables;
+    };
+
+    int operatorWaveform[4];
+    int operatorBankTable[4];           // tabla del banco para WAVE_BANK
+    std::shared_ptr<const Wavetable<T>> userWavetable;
+    std::shared_ptr<const LoadedBank> currentBank;
+    std::vector<RetiredTables> retiredTables;
+    std::atomic<uint64_t> renderCount;  // renders terminados
+
+    void retireTables(std::shared_ptr<const void> tables) {
+        if (tables) retiredTables.push_back({renderCount.load(std::memory_order_acquire), std::move(tables)});
+    }
+
+    const Wavetable<T>* resolveWavetable(int op) const {
+        switch (operatorWaveform[op]) {
+            case WAVE_USER:
+                return userWavetable.get();
+            case WAVE_BANK: {
+                if (!currentBank) return nullptr;
+                const auto& tables = currentBank->tables;
+                int t = operatorBankTable[op];
+                return t < (int)tables.size() ? tables[t].get() : nullptr;
+            }
+            default:
+                return builtinWavetable<T>(operatorWaveform[op]);
+        }
+    }
+
+    void applyOperatorWavetable(int op) {
+        const Wavetable<T>* table = resolveWavetable(op);
+        for (int v = 0; v < NUM_VOICES; v++) voices[v].synth->setWavetable(op, table);
+    }
+
+    void prefetchBankTable(int op) {
+        if (currentBank && operatorWaveform[op] == WAVE_BANK) currentBank->bank->prefetch(operatorBankTable[op]);
+    }
+
+    T left[MAX_BLOCK_SIZE];
+    T right[MAX_BLOCK_SIZE];
+    T voiceBuffer[MAX_BLOCK_SIZE];
+
+    int findFreeVoice() const {
+        for (int i = 0; i < NUM_VOICES; i++) {
+            if (voices[i].note == -1 && !voices[i].synth->isActive()) return i;
+        }
+        for (int i = 0; i < NUM_VOICES; i++) {
+            if (voices[i].note == -1) return i;
+        }
+        return 0;
+    }
+
+    // channel < 0 busca la nota en cualquier canal
+    int findVoiceWithNote(int note, int channel = -1) const {
+        for (int i = 0; i < NUM_VOICES; i++) {
+            if (voices[i].note == note && (channel < 0 || voices[i].channel == channel)) return i;
+        }
+        return -1;
+    }
+
+    // Paneo de una nota nueva: pan base + spread segun el modo
+    double notePan(int note) {
+        double offset;
+        if (spreadMode.load() == SPREAD_RANDOM) {
+            spreadSeed ^= spreadSeed << 13;
+            spreadSeed ^= spreadSeed >> 17;
+            spreadSeed ^= spreadSeed << 5;
+            offset = (spreadSeed & 0xFFFF) / 32767.5 - 1.0;
+        } else {
+            offset = std::max(-1.0, std::min(1.0, (note - 60) / 24.0));
+        }
+        return voicePan.load() + voiceSpread.load() * offset;
+    }
+
+    // Parametros del master con la columna m de la matriz, una vez por bloque
+    void updateEffectParams(bool routed, int m) {
+        double chorusValue = chorusMix.load();
+        double reverbValue = reverbMix.load();
+        double cutoff = filterCutoff.load();
+        double q = filterQ.load();
+        if (routed) {
+            chorusValue = clampModDestination(MOD_DST_CHORUS, chorusValue + modOffsets[MOD_DST_CHORUS][m]);
+            reverbValue = clampModDestination(MOD_DST_REVERB, reverbValue + modOffsets[MOD_DST_REVERB][m]);
+            cutoff = clampModDestination(MOD_DST_FILTER_CUT, cutoff + modOffsets[MOD_DST_FILTER_CUT][m]);
+            q = clampModDestination(MOD_DST_FILTER_Q, q + modOffsets[MOD_DST_FILTER_Q][m]);
+        }
+
+        chorus->setMix(chorusValue);
+        reverb->setMix(reverbValue);
+        fdnReverb->setMix(reverbValue);
+        convolutionReverb->setMix(reverbValue);
+
+        const double decay[3] = {fdnDecayLow.load(), fdnDecayHigh.load(), fdnCrossover.load()};
+        if (!std::equal(decay, decay + 3, appliedFdnDecay)) {
+            fdnReverb->setDecay(decay[0], decay[1], decay[2]);
+            std::copy(decay, decay + 3, appliedFdnDecay);
+        }
+
+        int type = filterType.load();
+        if (type != appliedFilterType || cutoff != appliedCutoff || q != appliedQ) {
+            if (type == FILTER_LOWPASS) {
+                filter->setLowPass(cutoff, q);
+            } else if (type == FILTER_HIGHPASS) {
+                filter->setHighPass(cutoff, q);
+            }
+            appliedFilterType = type;
+            appliedCutoff = cutoff;
+            appliedQ = q;
+        }
+    }
+
+    // Hilo de audio: noteOn encolado
+    void startNote(int note, double velocity, int channel) {
+        if (findVoiceWithNote(note, channel) >= 0) return;
+        const NoteTable& table = noteTable.read();
+        const NoteEntry& entry = table[note];
+        const double freq = entry.frequency;
+        if (freq <= 0.0) return;        // tecla sin mapear en la afinacion
+
+        int v = findFreeVoice();
+        Voice<T>& voice = voices[v];
+        for (int k = 0; k < NUM_LFOS; k++) {
+            if (!lfoKeySync[k].load()) continue;
+            if (lfoPerVoice[k].load()) {
+                voice.lfo[k].reset();
+            } else {
+                globalLfo[k].reset();
+            }
+        }
+        voice.setPan(notePan(note));
+        voice.velocity = velocity;
+        voice.key = (note - 60) / 60.0;
+        for (int l = 0; l < EXPR_LANE_COUNT; l++) expressionTarget[l][v] = 0.0;
+        expressionSnap[v] = true;
+
+        // Portamento desde la ultima nota tocada
+        double time = glideTime.load();
+        voice.glide = 0.0;
+        if (time > 0.0 && lastNoteFrequency > 0.0) {
+            voice.glide = 12.0 * std::log2(lastNoteFrequency / freq);
+            voice.glideRate = glideMode.load() == GLIDE_RATE ? 12000.0 / time
+                                                             : std::fabs(voice.glide) * 1000.0 / time;
+        }
+        lastNoteFrequency = freq;
+
+        voice.synth->noteOn(entry, table.velocity(velocity), semitonesToRatio(pitchBend.load() + voice.glide));
+        voice.channel = channel;
+        voice.note = note;
+        voiceNote[v].store(note, std::memory_order_relaxed);
+        lastVoice.store(v);
+    }
+
+    // Hilo de audio: noteOff encolado
+    void stopNote(int note, int channel) {
+        int v = findVoiceWithNote(note, channel);
+        if (v >= 0) {
+            voices[v].synth->noteOff();
+            voices[v].note = -1;
+            voiceNote[v].store(-1, std::memory_order_relaxed);
+        }
+    }
+
+    // Hilo de audio: expresion encolada; note < 0 aplica a todo el canal
+    void applyNoteExpression(int channel, int note, int lane, double value) {
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (voices[v].note < 0 || voices[v].channel != channel) continue;
+            if (note >= 0 && voices[v].note != note) continue;
+            expressionTarget[lane][v] = value;
+        }
+    }
+
+    void applyNoteEvents() {
+        NoteEvent e;
+        while (noteEvents.pop(e)) {
+            switch (e.type) {
+                case NOTE_EVENT_ON:
+                    startNote(e.note, e.value, e.channel);
+                    break;
+                case NOTE_EVENT_OFF:
+                    stopNote(e.note, e.channel);
+                    break;
+                case NOTE_EVENT_EXPRESSION:
+                    applyNoteExpression(e.channel, e.note, e.lane, e.value);
+                    break;
+            }
+        }
+    }
+
+    void processBlock(T* out, int n) {
+        applyNoteEvents();
+
+        int activeVoices[NUM_VOICES];
+        int numActive = 0;
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (voices[v].synth->isActive()) activeVoices[numActive++] = v;
+        }
+
+        // LFOs globales a control rate: un valor por tramo de CONTROL_BLOCK_SIZE
+        // samples. Corren siempre, aun en silencio, para no saltar de fase.
+        double rate[NUM_LFOS];
+        int waveform[NUM_LFOS];
+        bool perVoice[NUM_LFOS];
+        const int numSegments = (n + CONTROL_BLOCK_SIZE - 1) / CONTROL_BLOCK_SIZE;
+        for (int k = 0; k < NUM_LFOS; k++) {
+            rate[k] = lfoRate[k].load();
+            waveform[k] = lfoWaveform[k].load();
+            perVoice[k] = lfoPerVoice[k].load();
+            for (int s = 0; s < numSegments; s++) {
+                int len = std::min(CONTROL_BLOCK_SIZE, n - s * CONTROL_BLOCK_SIZE);
+                globalLfoValue[k][s] = globalLfo[k].advance(rate[k], len, waveform[k]);
+            }
+        }
+
+        // Todo en silencio: el master sigue recibiendo ceros hasta vaciar su
+        // latencia (lookahead y oversampling) y despues se limpia y se saltea
+        if (numActive == 0 && effectChain.isIdle()) {
+            if (masterDrain <= 0) {
+                std::fill(out, out + 2 * n, (T)0);
+                return;
+            }
+            std::fill(left, left + n, (T)0);
+            std::fill(right, right + n, (T)0);
+            processMaster(out, n);
+            masterDrain -= n;
+            if (masterDrain <= 0) resetMaster();
+            return;
+        }
+        masterDrain = limiter->getLatency() + saturators[0].getLatency();
+
+        VoiceControl patch[NUM_VOICES];
+        for (int a = 0; a < numActive; a++) voices[activeVoices[a]].synth->getPatchControl(patch[a]);
+        const double wheel = modWheel.load();
+        const double pressure = aftertouch.load();
+        const int m = numActive;            // columna del master, despues de las voces
+        bool routed = false;
+
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (!expressionSnap[v]) continue;
+            for (int l = 0; l < EXPR_LANE_COUNT; l++) expression[l][v] = expressionTarget[l][v];
+            expressionSnap[v] = false;
+        }
+        const double globalBend = pitchBend.load();
+        const double bendRange = noteBendRange.load();
+
+        // Bus estereo planar. Por cada tramo: fuentes de todas las voces (SoA),
+        // matriz de modulacion y render de cada voz sumado con su paneo.
+        std::fill(left, left + n, (T)0);
+        std::fill(right, right + n, (T)0);
+        for (int s = 0, offset = 0; s < numSegments; s++, offset += CONTROL_BLOCK_SIZE) {
+            const int len = std::min(CONTROL_BLOCK_SIZE, n - offset);
+
+            for (int l = 0; l < EXPR_LANE_COUNT; l++) {
+                for (int v = 0; v < NUM_VOICES; v++) expression[l][v] += (expressionTarget[l][v] - expression[l][v]) * expressionCoeff;
+            }
+
+            for (int a = 0; a < numActive; a++) {
+                const int v = activeVoices[a];
+                Voice<T>& voice = voices[v];
+                for (int k = 0; k < NUM_LFOS; k++) {
+                    modSources[MOD_SRC_LFO1 + k][a] = perVoice[k] ? voice.lfo[k].advance(rate[k], len, waveform[k])
+                                                                  : globalLfoValue[k][s];
+                }
+                modSources[MOD_SRC_MOD_ENV][a] = voice.synth->advanceModEnvelope(len);
+                modSources[MOD_SRC_AMP_ENV][a] = voice.synth->getEnvelopeLevel();
+                modSources[MOD_SRC_VELOCITY][a] = voice.velocity;
+                modSources[MOD_SRC_KEY][a] = voice.key;
+                modSources[MOD_SRC_AFTERTOUCH][a] = pressure;
+                modSources[MOD_SRC_MOD_WHEEL][a] = wheel;
+                modSources[MOD_SRC_PITCH_BEND][a] = expression[EXPR_PITCH_BEND][v];
+                modSources[MOD_SRC_PRESSURE][a] = expression[EXPR_PRESSURE][v];
+                modSources[MOD_SRC_SLIDE][a] = expression[EXPR_SLIDE][v];
+            }
+
+            // Columna del master: LFOs globales y envolventes de la ultima nota
+            const int lv = std::max(0, lastVoice.load());
+            const Voice<T>& last = voices[lv];
+            for (int k = 0; k < NUM_LFOS; k++) modSources[MOD_SRC_LFO1 + k][m] = globalLfoValue[k][s];
+            modSources[MOD_SRC_MOD_ENV][m] = last.synth->getModEnvelopeLevel();
+            modSources[MOD_SRC_AMP_ENV][m] = last.synth->getEnvelopeLevel();
+            modSources[MOD_SRC_VELOCITY][m] = last.velocity;
+            modSources[MOD_SRC_KEY][m] = last.key;
+            modSources[MOD_SRC_AFTERTOUCH][m] = pressure;
+            modSources[MOD_SRC_MOD_WHEEL][m] = wheel;
+            modSources[MOD_SRC_PITCH_BEND][m] = expression[EXPR_PITCH_BEND][lv];
+            modSources[MOD_SRC_PRESSURE][m] = expression[EXPR_PRESSURE][lv];
+            modSources[MOD_SRC_SLIDE][m] = expression[EXPR_SLIDE][lv];
+
+            routed = modMatrix.process(modSources, modOffsets, numActive + 1);
+
+            for (int a = 0; a < numActive; a++) {
+                const int v = activeVoices[a];
+                Voice<T>& voice = voices[v];
+                VoiceControl c = patch[a];
+
+                // Bend, portamento y vibrato se suman en semitonos; el oscilador
+                // rampea el incremento hasta el valor de fin de tramo
+                if (voice.glide != 0.0) {
+                    double step = voice.glideRate * len / sampleRate;
+                    voice.glide = std::fabs(voice.glide) <= step ? 0.0 : voice.glide - std::copysign(step, voice.glide);
+                }
+                double semitones = globalBend + expression[EXPR_PITCH_BEND][v] * bendRange + voice.glide;
+                if (routed) semitones += clampModDestination(MOD_DST_PITCH, modOffsets[MOD_DST_PITCH][a]);
+                c.pitch = semitonesToRatio(semitones);
+                if (routed) {
+                    for (int d = 0; d < 4; d++) {
+                        c.ratio[d] = clampModDestination(MOD_DST_RATIO1 + d, c.ratio[d] + modOffsets[MOD_DST_RATIO1 + d][a]);
+                        c.index[d] = clampModDestination(MOD_DST_INDEX1 + d, c.index[d] + modOffsets[MOD_DST_INDEX1 + d][a]);
+                    }
+                }
+                voice.synth->render(voiceBuffer, len, c);
+
+                const T gl = voice.gainL;
+                const T gr = voice.gainR;
+                T* l = left + offset;
+                T* r = right + offset;
+                for (int i = 0; i < len; i++) {
+                    l[i] += voiceBuffer[i] * gl;
+                    r[i] += voiceBuffer[i] * gr;
+                }
+            }
+        }
+
+        updateEffectParams(routed, m);
+        effectChain.process(left, right, n);
+        processMaster(out, n);
+    }
+
+    // Master: saturacion opcional, DC blocker y limitador con lookahead sobre
+    // left/right, intercalado en out
+    void processMaster(T* out, int n) {
+        T* channels[2] = {left, right};
+        bool saturate = saturationEnabled.load();
+        for (int c = 0; c < 2; c++) {
+            if (saturate) {
+                saturators[c].setCurve(saturationCurve.load());
+                saturators[c].setDrive(saturationDrive.load());
+                saturators[c].setOversampling(saturationOversampling.load());
+                saturators[c].process(channels[c], n);
+            }
+            dcBlockers[c]->process(channels[c], n);
+        }
+
+        limiter->setLookahead(limiterLookahead.load());
+        limiter->setCeiling(limiterCeiling.load());
+        limiter->setRelease(limiterRelease.load());
+        limiter->process(left, right, n);
+
+        for (int i = 0; i < n; i++) {
+            out[2 * i] = left[i];
+            out[2 * i + 1] = right[i];
+        }
+    }
+
+    void resetMaster() {
+        for (int c = 0; c < 2; c++) {
+            saturators[c].reset();
+            dcBlockers[c]->reset();
+        }
+        limiter->reset();
+    }
+
+public:
+    SynthEngine()
+        : masterDrain(0), sampleRate(0.0), chorusMix(0.0), reverbMix(0.0),
+          fdnDecayLow(2.5), fdnDecayHigh(1.2), fdnCrossover(3000.0),
+          voicePan(0.0), voiceSpread(0.0), spreadMode(SPREAD_KEY), spreadSeed(0x2545F491u),
+          saturationEnabled(false), saturationCurve(SAT_TANH), saturationDrive(1.0),
+          saturationOversampling(false), limiterLookahead(2.0), limiterCeiling(-0.3),
+          limiterRelease(50.0), filterType(FILTER_OFF), filterCutoff(1000.0), filterQ(0.707),
+          appliedCutoff(0.0), appliedQ(0.0), appliedFilterType(FILTER_OFF),
+          lastVoice(-1), modWheel(0.0), aftertouch(0.0), expressionCoeff(1.0),
+          pitchBend(0.0), noteBendRange(48.0), glideMode(GLIDE_TIME), glideTime(0.0),
+          lastNoteFrequency(0.0) {
+        for (int l = 0; l < EXPR_LANE_COUNT; l++) {
+            for (int v = 0; v < NUM_VOICES; v++) {
+                expressionTarget[l][v] = 0.0;
+                expression[l][v] = 0.0;
+            }
+        }
+        for (int v = 0; v < NUM_VOICES; v++) {
+            expressionSnap[v] = false;
+            voiceNote[v].store(-1);
+        }
+        for (int k = 0; k < NUM_LFOS; k++) {
+            lfoRate[k].store(2.0);
+            lfoWaveform[k].store(LFO_SINE);
+            lfoPerVoice[k].store(false);
+            lfoKeySync[k].store(false);
+        }
+        for (int k = 0; k < 4; k++) {
+            operatorWaveform[k] = WAVE_W1;
+            operatorBankTable[k] = 0;
+        }
+        renderCount.store(0);
+        builtinWavetable<T>(WAVE_W2);      // construye las tablas TX81Z fuera del audio
+        const int defaultOrder[] = {FX_FILTER, FX_CHORUS, FX_REVERB_SCHROEDER,
+                                    FX_REVERB_FDN, FX_REVERB_CONVOLUTION};
+        effectChain.setOrder(defaultOrder, FX_SLOT_COUNT);
+        effectChain.setBypass(FX_FILTER, true);
+        setReverbType(REVERB_SCHROEDER);
+        prepare(DEFAULT_SAMPLE_RATE);
+    }
+
+    // Reconfigura todo para una nueva frecuencia. No llamar con el stream corriendo.
+    void prepare(double sr) {
+        sampleRate = sr;
+        retiredTables.clear();              // sin stream ninguna voz las esta leyendo
+        expressionCoeff = 1.0 - exponentialDecay(CONTROL_BLOCK_SIZE / (0.005 * sr));     // ~5 ms
+        for (int i = 0; i < NUM_VOICES; i++) {
+            voices[i].synth = std::make_unique<FMSynth<T>>(440.0, sr);
+            voices[i].note = -1;
+            voiceNote[i].store(-1);
+            for (int k = 0; k < NUM_LFOS; k++) voices[i].lfo[k].setSampleRate(sr);
+            for (int k = 0; k < 4; k++) voices[i].synth->setWavetable(k, resolveWavetable(k));
+        }
+        for (int k = 0; k < NUM_LFOS; k++) globalLfo[k].setSampleRate(sr);
+        filter = std::make_unique<Filter<T>>(sr);
+        appliedFilterType = FILTER_OFF;     // recalcular coeficientes en el proximo bloque
+        chorus = std::make_unique<JunoChorus<T>>(sr);
+        reverb = std::make_unique<AtmosphericReverb<T>>(sr);
+        fdnReverb = std::make_unique<FDNReverb<T>>(sr);
+        std::fill(appliedFdnDecay, appliedFdnDecay + 3, 0.0);     // aplicar el decay en el proximo bloque
+        convolutionReverb = std::make_unique<ConvolutionReverb<T>>(sr);
+        for (int c = 0; c < 2; c++) {
+            dcBlockers[c] = std::make_unique<DCBlocker<T>>(sr);
+            saturators[c].reset();
+        }
+        limiter = std::make_unique<LookaheadLimiter<T>>(sr);
+        masterDrain = 0;
+        if (!impulseResponsePath.empty()) {
+            convolutionReverb->loadImpulseResponse(impulseResponsePath.c_str());
+        }
+
+        effectChain.setSlot(FX_FILTER, filter.get());
+        effectChain.setSlot(FX_CHORUS, chorus.get());
+        effectChain.setSlot(FX_REVERB_SCHROEDER, reverb.get());
+        effectChain.setSlot(FX_REVERB_FDN, fdnReverb.get());
+        effectChain.setSlot(FX_REVERB_CONVOLUTION, convolutionReverb.get());
+    }
+
+    double getSampleRate() const { return sampleRate; }
+
+    // La IR se remuestrea al sample rate actual y se recarga en cada prepare()
+    bool loadImpulseResponse(const char* path) {
+        if (!convolutionReverb->loadImpulseResponse(path)) return false;
+        impulseResponsePath = path;
+        return true;
+    }
+
+    bool hasImpulseResponse() const { return convolutionReverb->isLoaded(); }
+
+    // Forma de onda (OperatorWaveform) del operador op (0 a 3) en todas las voces
+    void setOperatorWaveform(int op, int waveform) {
+        if (op < 0 || op >= 4 || waveform < 0 || waveform >= WAVE_COUNT) return;
+        bool changed = operatorWaveform[op] != waveform;
+        operatorWaveform[op] = waveform;
+        if (changed) prefetchBankTable(op);
+        applyOperatorWavetable(op);
+    }
+
+    int getOperatorWaveform(int op) const { return operatorWaveform[op]; }
+
+    // Tabla del banco que usa el operador op con WAVE_BANK. Al cambiarla se
+    // piden sus paginas por adelantado, asi la primera nota no espera al disco.
+    void setOperatorBankTable(int op, int table) {
+        if (op < 0 || op >= 4 || table < 0) return;
+        bool changed = operatorBankTable[op] != table;
+        operatorBankTable[op] = table;
+        if (changed) prefetchBankTable(op);
+        applyOperatorWavetable(op);
+    }
+
+    int getOperatorBankTable(int op) const { return operatorBankTable[op]; }
+
+    // Banco de wavetables mapeado (.fmwt); reemplaza al actual. El mapeo se
+    // comparte con los otros motores que abran el mismo archivo.
+    bool loadWavetableBank(const char* path) {
+        std::shared_ptr<const WavetableBank> bank = openWavetableBank(path);
+        if (!bank) return false;
+        auto loaded = std::make_shared<LoadedBank>();
+        loaded->bank = bank;
+        for (int t = 0; t < bank->getCount(); t++) loaded->tables.push_back(makeBankWavetable<T>(*bank, t));
+        collectRetiredTables();
+        retireTables(std::move(currentBank));
+        currentBank = std::move(loaded);
+        for (int k = 0; k < 4; k++) {
+            if (operatorWaveform[k] != WAVE_BANK) continue;
+            prefetchBankTable(k);
+            applyOperatorWavetable(k);
+        }
+        return true;
+    }
+
+    int getBankTableCount() const { return currentBank ? currentBank->bank->getCount() : 0; }
+
+    // "" sin banco cargado o con un indice fuera del banco actual
+    const char* getBankTableName(int table) const {
+        if (table < 0 || table >= getBankTableCount()) return "";
+        return currentBank->bank->getName(table);
+    }
+
+    // Ciclo de usuario (WAV, el archivo entero es un ciclo) para WAVE_USER.
+    // Hasta cargar uno, User suena como W1.
+    bool loadUserWavetable(const char* path) {
+        auto table = std::make_shared<Wavetable<T>>();
+        if (!loadWavetableFile(path, *table)) return false;
+        collectRetiredTables();
+        retireTables(std::move(userWavetable));
+        userWavetable = std::move(table);
+        for (int k = 0; k < 4; k++) {
+            if (operatorWaveform[k] == WAVE_USER) applyOperatorWavetable(k);
+        }
+        return true;
+    }
+
+    // Renderiza numFrames frames estereo intercalados (L, R)
+    void render(T* out, int numFrames) {
+        ScopedDenormalGuard denormalGuard;
+
+        int done = 0;
+        while (done < numFrames) {
+            int n = std::min(MAX_BLOCK_SIZE, numFrames - done);
+            processBlock(out + 2 * done, n);
+            done += n;
+        }
+        renderCount.fetch_add(1, std::memory_order_release);
+    }
+
+    // Libera las tablas de usuario y los bancos reemplazados que ya no puede
+    // estar leyendo ninguna voz: los retirados antes del ultimo render
+    // terminado. Se llama desde el hilo de control (el desmapeo no es para el
+    // hilo de audio); cargar otra tabla lo hace solo.
+    void collectRetiredTables() {
+        const uint64_t renders = renderCount.load(std::memory_order_acquire);
+        retiredTables.erase(std::remove_if(retiredTables.begin(), retiredTables.end(),
+                                           [renders](const RetiredTables& r) { return r.renders < renders; }),
+                            retiredTables.end());
+    }
+
+    // Tablas reemplazadas que todavia esperan un render
+    int getRetiredTableCount() const { return (int)retiredTables.size(); }
+
+    // Voces. Las notas se encolan y el hilo de audio las aplica al principio
+    // del proximo bloque; si la cola esta llena el evento se pierde.
+    // velocity de 0 a 1; la frecuencia y el escalado salen de la tabla de notas
+    void noteOn(int note, double velocity = 1.0, int channel = 0) {
+        noteEvents.push({NOTE_EVENT_ON, note, channel, 0, velocity});
+    }
+
+    void noteOff(int note, int channel = -1) {
+        noteEvents.push({NOTE_EVENT_OFF, note, channel, 0, 0.0});
+    }
+
+    // Nota sonando segun el ultimo bloque de audio
+    bool isNoteActive(int note) const {
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (voiceNote[v].load(std::memory_order_relaxed) == note) return true;
+        }
+        return false;
+    }
+
+    bool isVoiceActive(int v) const { return voices[v].synth->isActive(); }
+
+    // Colas del filtro, las reverbs, el master y las envolventes exactamente
+    // en cero: despues de un rato de silencio no tiene que quedar ningun
+    // subnormal ni nada en el lookahead. Recorre las lineas de retardo; no
+    // llamar con el stream corriendo.
+    bool isTailStateZero() const {
+        for (int v = 0; v < NUM_VOICES; v++) {
+            if (voices[v].synth->getEnvelopeLevel() != 0.0) return false;
+        }
+        for (int c = 0; c < 2; c++) {
+            if (!saturators[c].isStateZero() || !dcBlockers[c]->isStateZero()) return false;
+        }
+        return filter->isStateZero() && reverb->isStateZero() && fdnReverb->isStateZero() &&
+               convolutionReverb->isStateZero() && limiter->isStateZero();
+    }
+
+    // Expresion por nota (ExpressionLane). note < 0 aplica a todas las notas
+    // del canal, que en MPE es una sola.
+    void setNoteExpression(int channel, int note, int lane, double value) {
+        noteEvents.push({NOTE_EVENT_EXPRESSION, note, channel, lane, value});
+    }
+
+    // Bend global (semitonos) y rango del bend por nota a fondo (semitonos, 48 en MPE)
+    void setPitchBend(double semitones) { pitchBend.store(semitones); }
+    void setNoteBendRange(double semitones) { noteBendRange.store(semitones); }
+
+    // Escalado por teclado y curva de velocidad del patch; aplica a las notas nuevas
+    void setKeyScaling(const KeyScaling& scaling) {
+        keyScaling = scaling;
+        publishNoteTable();
+    }
+
+    // Afinacion de esta parte (cada motor tiene la suya); aplica a las notas nuevas
+    void setTuning(const Tuning& t) {
+        tuning = t;
+        publishNoteTable();
+    }
+
+    // Escala Scala y mapeo de teclado opcional. Sin .kbm se usa el mapeo lineal
+    // con A4 = 440 Hz. Si un archivo no se puede leer la afinacion no cambia.
+    bool loadTuning(const char* sclPath, const char* kbmPath = nullptr) {
+        Tuning t = tuning;
+        if (!t.loadScale(sclPath)) return false;
+        if (kbmPath) {
+            if (!t.loadKeyboardMapping(kbmPath)) return false;
+        } else {
+            t.resetKeyboardMapping();
+        }
+        setTuning(t);
+        return true;
+    }
+
+    const Tuning& getTuning() const { return tuning; }
+
+    // Portamento: GLIDE_TIME en ms por nota, GLIDE_RATE en ms por octava; 0 lo apaga
+    void setGlide(int mode, double ms) {
+        glideMode.store(mode);
+        glideTime.store(std::max(0.0, ms));
+    }
+    FMSynth<T>& getVoice(int v) { return *voices[v].synth; }
+
+    // Paneo base (-1 a 1) y ancho del spread (0 a 1); aplican a las notas nuevas
+    void setPan(double pan) { voicePan.store(pan); }
+    void setSpread(double spread, int mode) {
+        voiceSpread.store(spread);
+        spreadMode.store(mode);
+    }
+
+    // Efectos
+    void setChorusMix(double mix) { chorusMix.store(mix); }
+    void setReverbMix(double mix) { reverbMix.store(mix); }
+
+    // Decay de la FDN: RT60 en segundos para graves y agudos, y cruce en Hz
+    void setFdnDecay(double lowSeconds, double highSeconds, double crossoverHz) {
+        fdnDecayLow.store(lowSeconds);
+        fdnDecayHigh.store(highSeconds);
+        fdnCrossover.store(crossoverHz);
+    }
+
+    // Solo suena la reverb elegida; las otras quedan en bypass dentro de la cadena
+    void setReverbType(int type) {
+        effectChain.setBypass(FX_REVERB_SCHROEDER, type != REVERB_SCHROEDER);
+        effectChain.setBypass(FX_REVERB_FDN, type != REVERB_FDN);
+        effectChain.setBypass(FX_REVERB_CONVOLUTION, type != REVERB_CONVOLUTION);
+    }
+
+    // Orden de la cadena por EffectSlot; se publica sin cortar el audio
+    void setEffectOrder(const int* slots, int count) { effectChain.setOrder(slots, count); }
+    int getEffectOrder(int* slots) const { return effectChain.getOrder(slots); }
+    void setEffectBypass(int slot, bool bypassed) { effectChain.setBypass(slot, bypassed); }
+    bool isEffectBypassed(int slot) const { return effectChain.isBypassed(slot); }
+
+    // Saturacion opcional antes del limitador; el oversampling 2x agrega 15 samples de latencia
+    void setSaturationEnabled(bool enabled) { saturationEnabled.store(enabled); }
+
+    void setSaturation(int curve, double drive, bool oversample) {
+        saturationCurve.store(curve);
+        saturationDrive.store(drive);
+        saturationOversampling.store(oversample);
+    }
+
+    // Limitador del master: lookahead 1-5 ms, techo en dBFS y release en ms
+    void setLimiter(double lookaheadMs, double ceilingDb, double releaseMs) {
+        limiterLookahead.store(lookaheadMs);
+        limiterCeiling.store(ceilingDb);
+        limiterRelease.store(releaseMs);
+    }
+
+    // LFO k: rate en Hz, depth 0-1, destino (LFOTarget) y forma de onda (LFOWaveform).
+    // El destino y el depth son la ruta k de la matriz.
+    void setLfo(int k, double rate, double depth, int target, int waveform) {
+        lfoRate[k].store(rate);
+        lfoWaveform[k].store(waveform);
+        modMatrix.setRoute(k, MOD_SRC_LFO1 + k, lfoTargetDestination(target), depth);
+    }
+
+    // Por voz: cada nota tiene su propio LFO (solo ratios e indices; los
+    // destinos del master siguen al global). Key sync reinicia la fase en noteOn.
+    void setLfoMode(int k, bool perVoice, bool keySync) {
+        lfoPerVoice[k].store(perVoice);
+        lfoKeySync[k].store(keySync);
+    }
+
+    // Ruta de la envolvente de modulacion (ModEnvTarget, amount -1 a 1)
+    void setModEnvelope(int target, double amount) {
+        modMatrix.setRoute(MOD_ROUTE_MOD_ENV, MOD_SRC_MOD_ENV, modEnvTargetDestination(target), amount);
+    }
+
+    // Rutas libres de la matriz (0 a MOD_USER_ROUTES - 1); destination -1 la borra
+    void setModRoute(int route, int source, int destination, double amount) {
+        if (route < 0 || route >= MOD_USER_ROUTES) return;
+        modMatrix.setRoute(MOD_ROUTE_USER + route, source, destination, amount);
+    }
+
+    // Controladores globales (0 a 1)
+    void setModWheel(double value) { modWheel.store(value); }
+    void setAftertouch(double value) { aftertouch.store(value); }
+
+    // Los coeficientes se recalculan en el hilo de audio cuando cambian
+    void setFilter(int type, double cutoff, double q) {
+        effectChain.setBypass(FX_FILTER, type == FILTER_OFF);
+        filterType.store(type);
+        filterCutoff.store(cutoff);
+        filterQ.store(q);
+    }
+};
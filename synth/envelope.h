@@ -1,5 +1,7 @@
 #pragma once
 #include <algorithm>
+#include <cmath>
+#include "denormals.h"
 
 enum EnvelopeState {
     ENV_IDLE,
@@ -9,21 +11,23 @@ enum EnvelopeState {
     ENV_RELEASE
 };
 
+template <typename T>
 class ADSREnvelope {
 private:
     double attackTime;
     double decayTime;
     double sustainLevel;
     double releaseTime;
+    double rateScale;           // escalado por teclado: >1 acelera todas las etapas
 
     EnvelopeState state;
-    double currentLevel;
+    T currentLevel;
     double sampleRate;
 
-    double attackIncrement;
-    double decayIncrement;
-    double releaseIncrement;
-    double releaseStartLevel;
+    T attackIncrement;
+    T decayIncrement;
+    T releaseIncrement;
+    T releaseStartLevel;
 
 public:
     ADSREnvelope(double sr)
@@ -31,6 +35,7 @@ public:
           decayTime(0.1),
           sustainLevel(0.7),
           releaseTime(0.3),
+          rateScale(1.0),
           state(ENV_IDLE),
           currentLevel(0.0),
           sampleRate(sr),
@@ -45,41 +50,41 @@ public:
     void noteOff() {
         if (state != ENV_IDLE) {
             releaseStartLevel = currentLevel;
-            releaseIncrement = releaseTime > 0.0 ? releaseStartLevel / (releaseTime * sampleRate) : releaseStartLevel;
+            releaseIncrement = releaseTime > 0.0 ? (T)(releaseStartLevel * rateScale / (releaseTime * sampleRate)) : releaseStartLevel;
             state = ENV_RELEASE;
         }
     }
 
-    double process() {
+    T process() {
         switch (state) {
             case ENV_IDLE:
-                currentLevel = 0.0;
+                currentLevel = 0;
                 break;
 
             case ENV_ATTACK:
                 currentLevel += attackIncrement;
-                if (currentLevel >= 1.0) {
-                    currentLevel = 1.0;
+                if (currentLevel >= 1) {
+                    currentLevel = 1;
                     state = ENV_DECAY;
                 }
                 break;
 
             case ENV_DECAY:
                 currentLevel -= decayIncrement;
-                if (currentLevel <= sustainLevel) {
-                    currentLevel = sustainLevel;
+                if (currentLevel <= (T)sustainLevel) {
+                    currentLevel = (T)sustainLevel;
                     state = ENV_SUSTAIN;
                 }
                 break;
 
             case ENV_SUSTAIN:
-                currentLevel = sustainLevel;
+                currentLevel = (T)sustainLevel;
                 break;
 
             case ENV_RELEASE:
                 currentLevel -= releaseIncrement;
-                if (currentLevel <= 0.0) {
-                    currentLevel = 0.0;
+                if (currentLevel <= getDenormalFloor()) {
+                    currentLevel = 0;
                     state = ENV_IDLE;
                 }
                 break;
@@ -88,9 +93,63 @@ public:
         return currentLevel;
     }
 
+    // Avanza numSamples de una vez (envolventes de control): equivale a
+    // llamar a process() numSamples veces, resolviendo cada etapa en forma cerrada
+    T advance(int numSamples) {
+        while (numSamples > 0) {
+            switch (state) {
+                case ENV_IDLE:
+                    currentLevel = 0;
+                    return currentLevel;
+
+                case ENV_ATTACK: {
+                    int steps = std::max(1, (int)std::ceil((1 - currentLevel) / attackIncrement));
+                    if (steps > numSamples) {
+                        currentLevel += attackIncrement * numSamples;
+                        return currentLevel;
+                    }
+                    currentLevel = 1;
+                    state = ENV_DECAY;
+                    numSamples -= steps;
+                    break;
+                }
+
+                case ENV_DECAY: {
+                    T distance = currentLevel - (T)sustainLevel;
+                    int steps = distance > 0 ? std::max(1, (int)std::ceil(distance / decayIncrement)) : 1;
+                    if (steps > numSamples) {
+                        currentLevel -= decayIncrement * numSamples;
+                        return currentLevel;
+                    }
+                    currentLevel = (T)sustainLevel;
+                    state = ENV_SUSTAIN;
+                    numSamples -= steps;
+                    break;
+                }
+
+                case ENV_SUSTAIN:
+                    currentLevel = (T)sustainLevel;
+                    return currentLevel;
+
+                case ENV_RELEASE: {
+                    T distance = currentLevel - (T)getDenormalFloor();
+                    int steps = distance > 0 ? std::max(1, (int)std::ceil(distance / releaseIncrement)) : 1;
+                    if (steps > numSamples) {
+                        currentLevel -= releaseIncrement * numSamples;
+                        return currentLevel;
+                    }
+                    currentLevel = 0;
+                    state = ENV_IDLE;
+                    return currentLevel;
+                }
+            }
+        }
+        return currentLevel;
+    }
+
     bool isActive() const { return state != ENV_IDLE; }
     EnvelopeState getState() const { return state; }
-    double getLevel() const { return currentLevel; }
+    T getLevel() const { return currentLevel; }
 
     void setAttack(double seconds) {
         attackTime = std::max(0.001, seconds);
@@ -112,6 +171,11 @@ public:
         updateIncrements();
     }
 
+    void setRateScale(double scale) {
+        rateScale = scale;
+        updateIncrements();
+    }
+
     double getAttack() const { return attackTime; }
     double getDecay() const { return decayTime; }
     double getSustain() const { return sustainLevel; }
@@ -119,7 +183,7 @@ public:
 
 private:
     void updateIncrements() {
-        attackIncrement = 1.0 / (attackTime * sampleRate);
-        decayIncrement = (1.0 - sustainLevel) / (decayTime * sampleRate);
+        attackIncrement = (T)(rateScale / (attackTime * sampleRate));
+        decayIncrement = (T)((1.0 - sustainLevel) * rateScale / (decayTime * sampleRate));
     }
 };
@@ -0,0 +1,223 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "tail_tracker.h"
+#include "denormals.h"
+#include "effect_chain.h"
+
+// Reverb FDN (Feedback Delay Network)
+// NUM_LINES lineas de retardo moduladas con matriz de feedback Hadamard
+// (butterfly in-place) y decay separado para graves y agudos.
+template <typename T, int NUM_LINES>
+class FDNReverbN : public Effect<T> {
+    static_assert(NUM_LINES == 8 || NUM_LINES == 16, "FDN de 8 o 16 lineas");
+
+private:
+    std::vector<T> memory;              // [pos * NUM_LINES + linea]
+    int mask;
+    int writeIndex;
+
+    // Largo de cada linea en entero y fraccion por separado: la fraccion mas
+    // la modulacion es un numero chico y conserva toda la resolucion en float
+    int delayWhole[NUM_LINES];
+    T delayFrac[NUM_LINES];
+    T lowState[NUM_LINES];
+    T gainLow[NUM_LINES];
+    T gainHigh[NUM_LINES];
+    T crossoverCoeff;
+
+    // LFOs recursivos para modular el largo de cada linea
+    T modSin[NUM_LINES];
+    T modCos[NUM_LINES];
+    T rotSin[NUM_LINES];
+    T rotCos[NUM_LINES];
+    T modDepth;
+
+    double decayLow;
+    double decayHigh;
+    double crossover;
+    double sampleRate;
+    double mix;
+
+    TailTracker tail;
+
+    static int nextPowerOfTwo(int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Hadamard normalizada: log2(N) etapas de sumas/restas
+    static void hadamard(T* x) {
+        for (int h = 1; h < NUM_LINES; h <<= 1) {
+            for (int i = 0; i < NUM_LINES; i += 2 * h) {
+                for (int j = i; j < i + h; j++) {
+                    T a = x[j];
+                    T b = x[j + h];
+                    x[j] = a + b;
+                    x[j + h] = a - b;
+                }
+            }
+        }
+        const T norm = 1.0f / std::sqrt((T)NUM_LINES);
+        for (int i = 0; i < NUM_LINES; i++) x[i] *= norm;
+    }
+
+    void updateGains() {
+        for (int i = 0; i < NUM_LINES; i++) {
+            // Ganancia por vuelta para caer 60 dB en el tiempo pedido
+            const double delay = delayWhole[i] + (double)delayFrac[i];
+            gainLow[i] = (T)std::pow(10.0, -3.0 * delay / (decayLow * sampleRate));
+            gainHigh[i] = (T)std::pow(10.0, -3.0 * delay / (decayHigh * sampleRate));
+        }
+        crossoverCoeff = (T)(1.0 - std::exp(-2.0 * 3.14159265 * crossover / sampleRate));
+    }
+
+public:
+    FDNReverbN(double sr)
+        : writeIndex(0), decayLow(2.5), decayHigh(1.2), crossover(3000.0), sampleRate(sr), mix(0.0) {
+        // Largos mutuamente primos entre ~23 y ~90 ms a 44.1 kHz
+        const int baseDelays[16] = {1031, 1327, 1523, 1871, 2053, 2311, 2539, 2857,
+                                    3089, 3331, 3581, 3823, 4001, 4253, 4513, 4789};
+        const double srRatio = sr / 44100.0;
+        const int step = 16 / NUM_LINES;
+
+        modDepth = (T)(0.0004 * sr);
+        int maxDelay = 0;
+        for (int i = 0; i < NUM_LINES; i++) {
+            const double delay = baseDelays[i * step] * srRatio;
+            delayWhole[i] = (int)delay;
+            delayFrac[i] = (T)(delay - delayWhole[i]);
+            maxDelay = std::max(maxDelay, delayWhole[i] + 1);
+            lowState[i] = 0.0f;
+
+            double rate = 0.1 + 0.07 * i;
+            double w = 2.0 * 3.14159265 * rate / sr;
+            double phase = 2.0 * 3.14159265 * i / NUM_LINES;
+            rotSin[i] = (T)std::sin(w);
+            rotCos[i] = (T)std::cos(w);
+            modSin[i] = (T)std::sin(phase);
+            modCos[i] = (T)std::cos(phase);
+        }
+
+        int size = nextPowerOfTwo(maxDelay + (int)modDepth + 2);
+        mask = size - 1;
+        memory.assign((size_t)size * NUM_LINES, 0.0f);
+        tail.setTailLength(size);
+        updateGains();
+    }
+
+    void reset() {
+        std::fill(memory.begin(), memory.end(), 0.0f);
+        for (int i = 0; i < NUM_LINES; i++) lowState[i] = 0.0f;
+    }
+
+    bool isIdle() const override { return tail.isIdle(); }
+
+    void setMix(double m) { mix = m; }
+
+    // Lineas y filtros de decay exactamente en cero (recorre toda la memoria)
+    bool isStateZero() const {
+        for (int i = 0; i < NUM_LINES; i++) {
+            if (lowState[i] != 0) return false;
+        }
+        for (T v : memory) {
+            if (v != 0) return false;
+        }
+        return true;
+    }
+
+    // RT60 en segundos para la banda baja y alta, y frecuencia de cruce
+    void setDecay(double lowSeconds, double highSeconds, double crossoverHz) {
+        decayLow = std::max(0.05, lowSeconds);
+        decayHigh = std::max(0.05, highSeconds);
+        crossover = std::max(100.0, std::min(sampleRate * 0.45, crossoverHz));
+        updateGains();
+    }
+
+    double getDecayLow() const { return decayLow; }
+    double getDecayHigh() const { return decayHigh; }
+    double getCrossover() const { return crossover; }
+
+    // Procesa in-place un bloque estereo
+    void process(T* left, T* right, int numSamples) override {
+        if (mix <= 0.0) {
+            if (!tail.isIdle()) {
+                reset();
+                tail.setIdle();
+            }
+            return;
+        }
+        float inputPeak = std::max(TailTracker::peak(left, numSamples), TailTracker::peak(right, numSamples));
+        if (tail.canSkip(inputPeak)) return;
+
+        const T wetGain = (T)mix;
+        const T dryGain = 1.0f - wetGain;
+        const T inGain = 1.0f / std::sqrt((T)NUM_LINES);
+        const T outGain = 2.0f / (T)NUM_LINES;
+        T* mem = memory.data();
+        T statePeak = 0.0f;
+
+        for (int n = 0; n < numSamples; n++) {
+            const T inL = (T)left[n];
+            const T inR = (T)right[n];
+
+            // Lectura a writeIndex - largo: los enteros y la fraccion van por
+            // separado, asi la fraccion no pierde resolucion con indices grandes
+            T y[NUM_LINES];
+            for (int i = 0; i < NUM_LINES; i++) {
+                T offset = delayFrac[i] + modDepth * modSin[i];
+                T shift = std::floor(offset);
+                int idx = writeIndex - delayWhole[i] - (int)shift - 1;
+                T frac = (T)1 - (offset - shift);
+                T a = mem[(size_t)(idx & mask) * NUM_LINES + i];
+                T b = mem[(size_t)((idx + 1) & mask) * NUM_LINES + i];
+                y[i] = a + (b - a) * frac;
+
+                T s = modSin[i] * rotCos[i] + modCos[i] * rotSin[i];
+                T c = modCos[i] * rotCos[i] - modSin[i] * rotSin[i];
+                modSin[i] = s;
+                modCos[i] = c;
+            }
+
+            T fb[NUM_LINES];
+            for (int i = 0; i < NUM_LINES; i++) {
+                lowState[i] += crossoverCoeff * (y[i] - lowState[i]);
+                fb[i] = gainLow[i] * lowState[i] + gainHigh[i] * (y[i] - lowState[i]);
+            }
+            hadamard(fb);
+
+            T* row = mem + (size_t)(writeIndex & mask) * NUM_LINES;
+            for (int i = 0; i < NUM_LINES; i++) {
+                row[i] = fb[i] + ((i & 1) ? inR : inL) * inGain;
+                statePeak = std::max(statePeak, std::fabs(row[i]));
+            }
+            writeIndex = (writeIndex + 1) & mask;
+
+            // Salidas con patrones de signo distintos para decorrelar L/R
+            T wetL = 0.0f, wetR = 0.0f;
+            for (int i = 0; i < NUM_LINES; i++) {
+                wetL += (i & 2) ? -y[i] : y[i];
+                wetR += (i & 1) ? -y[i] : y[i];
+            }
+
+            left[n] = inL * dryGain + wetL * outGain * wetGain;
+            right[n] = inR * dryGain + wetR * outGain * wetGain;
+        }
+
+        for (int i = 0; i < NUM_LINES; i++) {
+            T mag = std::sqrt(modSin[i] * modSin[i] + modCos[i] * modCos[i]);
+            modSin[i] /= mag;
+            modCos[i] /= mag;
+        }
+
+        const T floor = getDenormalFloor();
+        for (int i = 0; i < NUM_LINES; i++) lowState[i] = flushBelow(lowState[i], floor);
+
+        if (tail.update(inputPeak, statePeak, numSamples)) reset();
+    }
+};
+
+template <typename T>
+using FDNReverb = FDNReverbN<T, 8>;
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <utility>
+
+// FFT compleja radix-2 iterativa sobre arrays separados (re / im)
+template <typename T>
+class FFT {
+private:
+    int size;
+    std::vector<int> bitReverse;
+    std::vector<T> cosTable;
+    std::vector<T> sinTable;
+
+public:
+    explicit FFT(int n = 0) : size(0) {
+        if (n > 0) init(n);
+    }
+
+    // n debe ser potencia de dos
+    void init(int n) {
+        size = n;
+        int bits = 0;
+        while ((1 << bits) < n) bits++;
+
+        bitReverse.resize(n);
+        for (int i = 0; i < n; i++) {
+            int r = 0;
+            for (int b = 0; b < bits; b++) {
+                if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+            }
+            bitReverse[i] = r;
+        }
+
+        cosTable.resize(n / 2);
+        sinTable.resize(n / 2);
+        for (int k = 0; k < n / 2; k++) {
+            double w = 2.0 * 3.14159265358979323846 * k / n;
+            cosTable[k] = (T)std::cos(w);
+            sinTable[k] = (T)std::sin(w);
+        }
+    }
+
+    int getSize() const { return size; }
+
+    void forward(T* re, T* im) const { transform(re, im, -1.0f); }
+
+    // Inversa normalizada (incluye el 1/N)
+    void inverse(T* re, T* im) const {
+        transform(re, im, 1.0f);
+        const T scale = 1.0f / (T)size;
+        for (int i = 0; i < size; i++) {
+            re[i] *= scale;
+            im[i] *= scale;
+        }
+    }
+
+private:
+    void transform(T* re, T* im, T sign) const {
+        for (int i = 0; i < size; i++) {
+            int j = bitReverse[i];
+            if (j > i) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+
+        for (int len = 2; len <= size; len <<= 1) {
+            int half = len / 2;
+            int step = size / len;
+            for (int i = 0; i < size; i += len) {
+                for (int k = 0; k < half; k++) {
+                    T wr = cosTable[k * step];
+                    T wi = sign * sinTable[k * step];
+                    int a = i + k;
+                    int b = a + half;
+                    T tr = re[b] * wr - im[b] * wi;
+                    T ti = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+    }
+};
@@ -1,5 +1,9 @@
 #pragma once
 #include <cmath>
+#include <algorithm>
+#include "tail_tracker.h"
+#include "denormals.h"
+#include "effect_chain.h"
 
 enum FilterType {
     FILTER_OFF = 0,
@@ -7,15 +11,19 @@ enum FilterType {
     FILTER_HIGHPASS
 };
 
-class Filter {
+// Biquad estereo (estado independiente por canal, coeficientes compartidos)
+template <typename T>
+class Filter : public Effect<T> {
 private:
-    double y1, y2, x1, x2;
-    double a0, a1, a2, b1, b2;
+    T y1[2], y2[2], x1[2], x2[2];
+    T a0, a1, a2, b1, b2;
     double sampleRate;
+    TailTracker tail;
 
 public:
-    Filter(double sr) : sampleRate(sr), y1(0), y2(0), x1(0), x2(0),
-                        a0(1), a1(0), a2(0), b1(0), b2(0) {}
+    Filter(double sr) : a0(1), a1(0), a2(0), b1(0), b2(0), sampleRate(sr), tail(64) {
+        reset();
+    }
 
     void setLowPass(double cutoff, double q) {
         double w0 = 2.0 * 3.14159265 * cutoff / sampleRate;
@@ -30,8 +38,8 @@ public:
         double a1_t = -2.0 * cosw0;
         double a2_t = 1.0 - alpha;
 
-        a0 = b0 / a0_t; a1 = b1_t / a0_t; a2 = b2_t / a0_t;
-        b1 = a1_t / a0_t; b2 = a2_t / a0_t;
+        a0 = (T)(b0 / a0_t); a1 = (T)(b1_t / a0_t); a2 = (T)(b2_t / a0_t);
+        b1 = (T)(a1_t / a0_t); b2 = (T)(a2_t / a0_t);
     }
 
     void setHighPass(double cutoff, double q) {
@@ -47,16 +55,49 @@ public:
         double a1_t = -2.0 * cosw0;
         double a2_t = 1.0 - alpha;
 
-        a0 = b0 / a0_t; a1 = b1_t / a0_t; a2 = b2_t / a0_t;
-        b1 = a1_t / a0_t; b2 = a2_t / a0_t;
+        a0 = (T)(b0 / a0_t); a1 = (T)(b1_t / a0_t); a2 = (T)(b2_t / a0_t);
+        b1 = (T)(a1_t / a0_t); b2 = (T)(a2_t / a0_t);
     }
 
-    double process(double input) {
-        double output = a0 * input + a1 * x1 + a2 * x2 - b1 * y1 - b2 * y2;
-        x2 = x1; x1 = input;
-        y2 = y1; y1 = output;
+    T process(T input, int ch) {
+        T output = a0 * input + a1 * x1[ch] + a2 * x2[ch] - b1 * y1[ch] - b2 * y2[ch];
+        x2[ch] = x1[ch]; x1[ch] = input;
+        y2[ch] = y1[ch]; y1[ch] = output;
         return output;
     }
 
-    void reset() { y1 = y2 = x1 = x2 = 0.0; }
+    // Procesa in-place un bloque estereo; se saltea si no hay senal ni estado
+    void process(T* left, T* right, int numSamples) override {
+        float inputPeak = std::max(TailTracker::peak(left, numSamples), TailTracker::peak(right, numSamples));
+        if (tail.canSkip(inputPeak)) return;
+
+        T* io[2] = {left, right};
+        const T floor = getDenormalFloor();
+        float statePeak = 0.0f;
+        for (int c = 0; c < 2; c++) {
+            for (int i = 0; i < numSamples; i++) {
+                io[c][i] = process(io[c][i], c);
+            }
+
+            y1[c] = flushBelow(y1[c], floor); y2[c] = flushBelow(y2[c], floor);
+            x1[c] = flushBelow(x1[c], floor); x2[c] = flushBelow(x2[c], floor);
+            statePeak = std::max(statePeak, (float)std::max(std::max(std::fabs(y1[c]), std::fabs(y2[c])),
+                                                            std::max(std::fabs(x1[c]), std::fabs(x2[c]))));
+        }
+        if (tail.update(inputPeak, statePeak, numSamples)) reset();
+    }
+
+    bool isIdle() const override { return tail.isIdle(); }
+
+    // Estado exactamente en cero (la cola no dejo subnormales colgados)
+    bool isStateZero() const {
+        for (int c = 0; c < 2; c++) {
+            if (y1[c] != 0 || y2[c] != 0 || x1[c] != 0 || x2[c] != 0) return false;
+        }
+        return true;
+    }
+
+    void reset() {
+        for (int c = 0; c < 2; c++) y1[c] = y2[c] = x1[c] = x2[c] = 0;
+    }
 };
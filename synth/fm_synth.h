@@ -1,7 +1,11 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
 #include "oscillator.h"
 #include "envelope.h"
+#include "unison.h"
+#include "note_table.h"
+#include "wavetable.h"
 
 enum FMAlgorithm {
     ALG_STACK = 0,      // 4 -> 3 -> 2 -> 1 (serie completa)
@@ -17,22 +21,153 @@ inline const char* algorithmNames[] = {
     "Stack", "Twin", "Branch", "Parallel", "Dual", "Triple"
 };
 
+// Conjuntos de operadores por algoritmo: bit k = op k + 1
+const int OP1_BIT = 1 << 0, OP2_BIT = 1 << 1, OP3_BIT = 1 << 2, OP4_BIT = 1 << 3;
+
+// Operadores sin entrada de modulacion. op1 nunca entra: tiene feedback.
+inline int freeOperators(int algorithm) {
+    switch (algorithm) {
+        case ALG_TWIN:
+        case ALG_DUAL_CARRIER: return OP2_BIT | OP4_BIT;
+        case ALG_PARALLEL: return OP2_BIT | OP3_BIT | OP4_BIT;
+        default: return OP4_BIT;
+    }
+}
+
+// Operadores que suenan (van a la salida)
+inline int carrierOperators(int algorithm) {
+    switch (algorithm) {
+        case ALG_DUAL_CARRIER: return OP1_BIT | OP3_BIT;
+        case ALG_TRIPLE: return OP1_BIT | OP2_BIT | OP3_BIT;
+        default: return OP1_BIT;
+    }
+}
+
+// Operadores que modula op (0 a 3). En todos los algoritmos la salida de un
+// modulador llega a destino multiplicada por su propio indice (op k por idx k).
+inline int modulationTargets(int algorithm, int op) {
+    if (carrierOperators(algorithm) & (1 << op)) return 0;
+    switch (op) {
+        case 1: return OP1_BIT;
+        case 2: return algorithm == ALG_STACK ? OP2_BIT : OP1_BIT;
+        case 3:
+            switch (algorithm) {
+                case ALG_BRANCH: return OP2_BIT | OP3_BIT;
+                case ALG_PARALLEL: return OP1_BIT;
+                case ALG_TRIPLE: return OP1_BIT | OP2_BIT | OP3_BIT;
+                default: return OP3_BIT;
+            }
+        default: return 0;
+    }
+}
+
+// Ratios e indices de una voz para un tramo de control (ya modulados)
+struct VoiceControl {
+    double ratio[4];
+    double index[4];
+    double pitch;       // multiplicador de la frecuencia de la nota (pitch bend)
+};
+
+template <typename T>
 class FMSynth {
 private:
-    Oscillator op1, op2, op3, op4;
-    ADSREnvelope envelope;
+    Oscillator<T> op1, op2, op3, op4;
+    ADSREnvelope<T> envelope;
+    ADSREnvelope<T> modEnvelope;        // envolvente de modulacion (control rate)
+    UnisonBank<T> unison;
 
     std::atomic<double> ratio1, ratio2, ratio3, ratio4;
     std::atomic<double> index1, index2, index3, index4;
 
-    double prevSample1;
+    T prevSample1;
+
+    // Indices que usa el hilo de audio; render() los lleva en rampa al control del tramo
+    T indexValue[4];
+    T indexStep[4];
 
     std::atomic<int> algorithm;
-    double amplitude;
+    T amplitude;
+    T gain;                             // amplitude * nivel por tecla * velocidad
+    double keyIndexScale;               // escalado de indices de la nota actual
     std::atomic<bool> noteActive;
     std::atomic<double> currentFrequency;
     double sampleRate;
 
+    std::atomic<int> unisonVoices;
+    std::atomic<double> unisonDetune;
+    int unisonLanes;                    // configuracion aplicada al banco
+
+    // Salida de los operadores libres (freeOperators) del tramo actual, en
+    // bloque; sin freeOut el operador se evalua sample a sample
+    T freeOut[3][MAX_BLOCK_SIZE];       // op2, op3, op4
+    int liveOperators;                  // operadores que aportan algo en el tramo actual
+    std::atomic<bool> pruning;          // false: se evaluan todos aunque no aporten
+
+    // Forma de onda por operador (nullptr = seno); las tablas son del motor
+    std::atomic<const Wavetable<T>*> wavetable[4];
+
+    void applyWavetables() {
+        const Wavetable<T>* w[4];
+        for (int k = 0; k < 4; k++) w[k] = wavetable[k].load(std::memory_order_acquire);
+        op1.setWavetable(w[0]); op2.setWavetable(w[1]);
+        op3.setWavetable(w[2]); op4.setWavetable(w[3]);
+        for (int k = 0; k < UNISON_CARRIERS; k++) unison.setWavetable(k, w[k]);
+    }
+
+    // Carrier op1 (con feedback): una lane o el stack de unison
+    T carrier1(T modulation, T feedbackIndex) {
+        if (unisonLanes > 1) return unison.processFeedback(modulation, feedbackIndex);
+        prevSample1 = op1.process(modulation + feedbackIndex * prevSample1);
+        return prevSample1;
+    }
+
+    // Modulador con entrada: un operador podado no se evalua (su fase ya
+    // avanzo en render)
+    T modulator(int op, Oscillator<T>& osc, T modulation) {
+        return (liveOperators & (1 << op)) ? osc.process(modulation) : 0;
+    }
+
+    // Un modulador aporta si su indice no es cero en el tramo (arranca y
+    // termina en cero: la rampa es exactamente cero) y modula algun operador
+    // que aporta. Los destinos tienen numero menor, asi que basta una pasada.
+    int findLiveOperators(int alg, const T* target) const {
+        int live = carrierOperators(alg);
+        for (int k = 1; k < 4; k++) {
+            const bool silent = indexValue[k] == 0 && target[k] == 0;
+            if (!silent && (modulationTargets(alg, k) & live)) live |= 1 << k;
+        }
+        return live;
+    }
+
+    // Operador libre: en bloque si aporta; si no, ceros y la fase en forma cerrada
+    void renderFree(Oscillator<T>& osc, int op, T* buffer, int numSamples) {
+        if (liveOperators & (1 << op)) {
+            osc.processFree(buffer, numSamples);
+        } else {
+            osc.skip(numSamples);
+            std::fill(buffer, buffer + numSamples, (T)0);
+        }
+    }
+
+    // Carriers op2 / op3 (solo en Dual y Triple)
+    T carrier(int c, Oscillator<T>& op, T modulation) {
+        if (unisonLanes > 1) return unison.process(c, modulation);
+        return op.process(modulation);
+    }
+
+    void loadPatchIndices() {
+        indexValue[0] = (T)(index1.load() * keyIndexScale);
+        indexValue[1] = (T)(index2.load() * keyIndexScale);
+        indexValue[2] = (T)(index3.load() * keyIndexScale);
+        indexValue[3] = (T)(index4.load() * keyIndexScale);
+    }
+
+    void updateUnisonFrequencies(double freq) {
+        unison.setFrequency(0, freq * ratio1.load());
+        unison.setFrequency(1, freq * ratio2.load());
+        unison.setFrequency(2, freq * ratio3.load());
+    }
+
 public:
     FMSynth(double freq, double sr)
         : op1(freq, sr),
@@ -40,104 +175,195 @@ public:
           op3(freq * 3.0, sr),
           op4(freq * 4.0, sr),
           envelope(sr),
+          modEnvelope(sr),
+          unison(sr),
           ratio1(1.0), ratio2(2.0), ratio3(3.0), ratio4(4.0),
           index1(0.0), index2(2.0), index3(1.5), index4(1.0),
           prevSample1(0.0),
           algorithm(ALG_STACK),
           amplitude(0.3),
+          gain(0.3),
+          keyIndexScale(1.0),
           noteActive(false),
           currentFrequency(freq),
-          sampleRate(sr) {}
+          sampleRate(sr),
+          unisonVoices(1),
+          unisonDetune(0.0),
+          unisonLanes(1),
+          liveOperators(OP1_BIT | OP2_BIT | OP3_BIT | OP4_BIT),
+          pruning(true) {
+        for (int k = 0; k < 4; k++) {
+            indexStep[k] = 0;
+            wavetable[k].store(nullptr);
+        }
+        loadPatchIndices();
+    }
 
-    double process() {
-        if (!envelope.isActive()) return 0.0;
+    // Un sample del tramo; los operadores libres ya estan en freeOut[][i]
+    T process(int alg, int i) {
+        if (!envelope.isActive()) return 0;
 
-        double out1, out2, out3, out4;
-        double idx1 = index1.load();
-        double idx2 = index2.load();
-        double idx3 = index3.load();
-        double idx4 = index4.load();
+        T out1, out2, out3, out4;
+        const T idx1 = indexValue[0];
+        const T idx2 = indexValue[1];
+        const T idx3 = indexValue[2];
+        const T idx4 = indexValue[3];
 
-        double feedback = idx1 * prevSample1;
-        double envLevel = envelope.process();
+        T envLevel = envelope.process();
 
-        switch (algorithm.load()) {
+        // Los moduladores se evaluan una vez; solo los carriers se multiplican por el unison
+        switch (alg) {
             case ALG_STACK:
-                out4 = op4.process();
-                out3 = op3.process(idx4 * out4);
-                out2 = op2.process(idx3 * out3);
-                out1 = op1.process(idx2 * out2 + feedback);
+                out4 = freeOut[2][i];
+                out3 = modulator(2, op3, idx4 * out4);
+                out2 = modulator(1, op2, idx3 * out3);
+                out1 = carrier1(idx2 * out2, idx1);
                 break;
 
             case ALG_TWIN:
-                out4 = op4.process();
-                out3 = op3.process(idx4 * out4);
-                out2 = op2.process();
-                out1 = op1.process(idx3 * out3 + idx2 * out2 + feedback);
+                out4 = freeOut[2][i];
+                out3 = modulator(2, op3, idx4 * out4);
+                out2 = freeOut[0][i];
+                out1 = carrier1(idx3 * out3 + idx2 * out2, idx1);
                 break;
 
             case ALG_BRANCH:
-                out4 = op4.process();
-                out3 = op3.process(idx4 * out4);
-                out2 = op2.process(idx4 * out4);
-                out1 = op1.process(idx3 * out3 + idx2 * out2 + feedback);
+                out4 = freeOut[2][i];
+                out3 = modulator(2, op3, idx4 * out4);
+                out2 = modulator(1, op2, idx4 * out4);
+                out1 = carrier1(idx3 * out3 + idx2 * out2, idx1);
                 break;
 
             case ALG_PARALLEL:
-                out2 = op2.process();
-                out3 = op3.process();
-                out4 = op4.process();
-                out1 = op1.process(idx2 * out2 + idx3 * out3 + idx4 * out4 + feedback);
+                out2 = freeOut[0][i];
+                out3 = freeOut[1][i];
+                out4 = freeOut[2][i];
+                out1 = carrier1(idx2 * out2 + idx3 * out3 + idx4 * out4, idx1);
                 break;
 
             case ALG_DUAL_CARRIER:
-                out4 = op4.process();
-                out3 = op3.process(idx4 * out4);
-                out2 = op2.process();
-                out1 = op1.process(idx2 * out2 + feedback);
-                prevSample1 = out1;
-                return (out1 + out3 * 0.7) * amplitude * envLevel * 0.7;
+                out4 = freeOut[2][i];
+                out3 = carrier(2, op3, idx4 * out4);
+                out2 = freeOut[0][i];
+                out1 = carrier1(idx2 * out2, idx1);
+                return (out1 + out3 * (T)0.7) * gain * envLevel * (T)0.7;
 
             case ALG_TRIPLE:
-                out4 = op4.process();
-                out1 = op1.process(idx4 * out4 + feedback);
-                out2 = op2.process(idx4 * out4);
-                out3 = op3.process(idx4 * out4);
-                prevSample1 = out1;
-                return (out1 + out2 * 0.6 + out3 * 0.4) * amplitude * envLevel * 0.5;
+                out4 = freeOut[2][i];
+                out1 = carrier1(idx4 * out4, idx1);
+                out2 = carrier(1, op2, idx4 * out4);
+                out3 = carrier(2, op3, idx4 * out4);
+                return (out1 + out2 * (T)0.6 + out3 * (T)0.4) * gain * envLevel * (T)0.5;
 
             default:
-                return 0.0;
+                return 0;
         }
 
-        prevSample1 = out1;
-        return out1 * amplitude * envLevel;
+        return out1 * gain * envLevel;
     }
 
-    void noteOn(double freq) {
+    // Valores del patch sin modulacion
+    void getPatchControl(VoiceControl& c) const {
+        c.ratio[0] = ratio1.load(); c.ratio[1] = ratio2.load();
+        c.ratio[2] = ratio3.load(); c.ratio[3] = ratio4.load();
+        c.index[0] = index1.load(); c.index[1] = index2.load();
+        c.index[2] = index3.load(); c.index[3] = index4.load();
+        c.pitch = 1.0;
+    }
+
+    // Renderiza un tramo (hasta MAX_BLOCK_SIZE samples) llegando linealmente a
+    // los valores de control al final del tramo (incrementos de fase e
+    // indices), sin escalones
+    void render(T* out, int numSamples, const VoiceControl& c) {
+        if (numSamples <= 0) return;
+        double freq = currentFrequency.load() * c.pitch;
+        applyWavetables();
+        op1.rampFrequency(freq * c.ratio[0], numSamples);
+        op2.rampFrequency(freq * c.ratio[1], numSamples);
+        op3.rampFrequency(freq * c.ratio[2], numSamples);
+        op4.rampFrequency(freq * c.ratio[3], numSamples);
+        if (unisonLanes > 1) {
+            for (int k = 0; k < UNISON_CARRIERS; k++) unison.rampFrequency(k, freq * c.ratio[k], numSamples);
+        }
+        T target[4];
+        for (int k = 0; k < 4; k++) {
+            target[k] = (T)(c.index[k] * keyIndexScale);
+            indexStep[k] = (target[k] - indexValue[k]) / (T)numSamples;
+        }
+
+        // Los operadores que no aportan (indice cero o solo modulan operadores
+        // podados) no se evaluan; los libres se generan en bloque para el tramo
+        const int alg = algorithm.load();
+        if (envelope.isActive()) {
+            liveOperators = pruning.load() ? findLiveOperators(alg, target) : (OP1_BIT | OP2_BIT | OP3_BIT | OP4_BIT);
+            const int free = freeOperators(alg);
+            Oscillator<T>* ops[4] = { &op1, &op2, &op3, &op4 };
+            for (int k = 1; k < 4; k++) {
+                if (free & (1 << k)) {
+                    renderFree(*ops[k], k, freeOut[k - 1], numSamples);
+                } else if (!(liveOperators & (1 << k))) {
+                    ops[k]->skip(numSamples);
+                }
+            }
+        }
+
+        for (int i = 0; i < numSamples; i++) {
+            out[i] = process(alg, i);
+            for (int k = 0; k < 4; k++) indexValue[k] += indexStep[k];
+        }
+        for (int k = 0; k < 4; k++) indexValue[k] = target[k];
+    }
+
+    // Renderiza un bloque con los valores del patch
+    void render(T* out, int numSamples) {
+        VoiceControl c;
+        getPatchControl(c);
+        render(out, numSamples, c);
+    }
+
+    // Envolvente de modulacion a control rate: avanza un tramo y devuelve el nivel
+    double advanceModEnvelope(int numSamples) { return (double)modEnvelope.advance(numSamples); }
+
+    // La nota viene de la NoteTable del patch (frecuencia y escalados ya calculados).
+    // startPitch: multiplicador inicial (portamento desde la nota anterior);
+    // render() lo lleva al pitch de cada tramo
+    void noteOn(const NoteEntry& note, double velocityGain, double startPitch = 1.0) {
+        double freq = note.frequency;
+        keyIndexScale = note.indexScale;
+        gain = (T)(amplitude * note.levelScale * velocityGain);
+        envelope.setRateScale(note.rateScale);
+        modEnvelope.setRateScale(note.rateScale);
         currentFrequency.store(freq);
-        op1.setFrequency(freq * ratio1.load());
-        op2.setFrequency(freq * ratio2.load());
-        op3.setFrequency(freq * ratio3.load());
-        op4.setFrequency(freq * ratio4.load());
+        double start = freq * startPitch;
+        op1.setFrequency(start * ratio1.load());
+        op2.setFrequency(start * ratio2.load());
+        op3.setFrequency(start * ratio3.load());
+        op4.setFrequency(start * ratio4.load());
         op1.reset(); op2.reset(); op3.reset(); op4.reset();
-        prevSample1 = 0.0;
+        prevSample1 = 0;
+        loadPatchIndices();
+        unisonLanes = unisonVoices.load();
+        unison.configure(unisonLanes, unisonDetune.load());
+        updateUnisonFrequencies(start);
+        unison.reset();
         noteActive.store(true);
         envelope.noteOn();
+        modEnvelope.noteOn();
     }
 
     void noteOff() {
         noteActive.store(false);
         envelope.noteOff();
+        modEnvelope.noteOff();
     }
 
     bool isActive() const { return envelope.isActive(); }
 
-    // Setters
-    void setRatio1(double r) { ratio1.store(r); if (noteActive.load()) op1.setFrequency(currentFrequency.load() * r); }
-    void setRatio2(double r) { ratio2.store(r); if (noteActive.load()) op2.setFrequency(currentFrequency.load() * r); }
-    void setRatio3(double r) { ratio3.store(r); if (noteActive.load()) op3.setFrequency(currentFrequency.load() * r); }
-    void setRatio4(double r) { ratio4.store(r); if (noteActive.load()) op4.setFrequency(currentFrequency.load() * r); }
+    // Setters (los ratios se aplican en el proximo tramo de render)
+    void setRatio1(double r) { ratio1.store(r); }
+    void setRatio2(double r) { ratio2.store(r); }
+    void setRatio3(double r) { ratio3.store(r); }
+    void setRatio4(double r) { ratio4.store(r); }
 
     void setIndex1(double i) { index1.store(i); }
     void setIndex2(double i) { index2.store(i); }
@@ -145,11 +371,31 @@ public:
     void setIndex4(double i) { index4.store(i); }
     void setAlgorithm(int alg) { algorithm.store(alg); }
 
+    // Sin poda se evaluan todos los operadores: la salida es la misma, sirve
+    // de referencia para compararla
+    void setPruning(bool on) { pruning.store(on); }
+
+    // Tabla del operador op (0 a 3); se aplica en el proximo tramo de render.
+    // La tabla tiene que seguir viva mientras alguna voz la use.
+    void setWavetable(int op, const Wavetable<T>* table) { wavetable[op].store(table, std::memory_order_release); }
+
+    // Unison por patch: se aplica en el proximo noteOn
+    void setUnison(int voices, double detuneCents) {
+        unisonVoices.store(voices < 1 ? 1 : (voices > MAX_UNISON ? MAX_UNISON : voices));
+        unisonDetune.store(detuneCents);
+    }
+
     void setAttack(double t) { envelope.setAttack(t); }
     void setDecay(double t) { envelope.setDecay(t); }
     void setSustain(double l) { envelope.setSustain(l); }
     void setRelease(double t) { envelope.setRelease(t); }
 
+    // Forma de la envolvente de modulacion (el ruteo esta en la matriz del motor)
+    void setModAttack(double t) { modEnvelope.setAttack(t); }
+    void setModDecay(double t) { modEnvelope.setDecay(t); }
+    void setModSustain(double l) { modEnvelope.setSustain(l); }
+    void setModRelease(double t) { modEnvelope.setRelease(t); }
+
     // Getters
     double getRatio1() const { return ratio1.load(); }
     double getRatio2() const { return ratio2.load(); }
@@ -160,8 +406,12 @@ public:
     double getIndex3() const { return index3.load(); }
     double getIndex4() const { return index4.load(); }
     int getAlgorithm() const { return algorithm.load(); }
+    int getLiveOperators() const { return liveOperators; }     // del ultimo tramo (bit k = op k + 1)
+    int getUnisonVoices() const { return unisonVoices.load(); }
+    double getUnisonDetune() const { return unisonDetune.load(); }
     double getCurrentFrequency() const { return currentFrequency.load(); }
 
-    double getEnvelopeLevel() const { return envelope.getLevel(); }
+    double getEnvelopeLevel() const { return (double)envelope.getLevel(); }
+    double getModEnvelopeLevel() const { return (double)modEnvelope.getLevel(); }
     EnvelopeState getEnvelopeState() const { return envelope.getState(); }
 };
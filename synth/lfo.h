@@ -1,6 +1,7 @@
 #pragma once
 #include <cmath>
 #include "constants.h"
+#include "dsp_tables.h"
 
 enum LFOTarget {
     LFO_OFF = 0,
@@ -8,13 +9,15 @@ enum LFOTarget {
     LFO_INDEX1, LFO_INDEX2, LFO_INDEX3, LFO_INDEX4,
     LFO_FILTER_CUT, LFO_FILTER_Q,
     LFO_CHORUS, LFO_REVERB,
+    LFO_PITCH,
     LFO_TARGET_COUNT
 };
 
 inline const char* lfoTargetNames[] = {
     "OFF", "Ratio1", "Ratio2", "Ratio3", "Ratio4",
     "Index1", "Index2", "Index3", "Index4",
-    "Filter", "Res", "Chorus", "Reverb"
+    "Filter", "Res", "Chorus", "Reverb",
+    "Pitch"
 };
 
 // Mod Envelope targets
@@ -29,27 +32,64 @@ inline const char* modEnvTargetNames[] = {
     "OFF", "Idx1", "Idx2", "Idx3", "Idx4", "Filter"
 };
 
+enum LFOWaveform {
+    LFO_SINE = 0,
+    LFO_TRIANGLE,
+    LFO_SAW,
+    LFO_SQUARE,
+    LFO_SAMPLE_HOLD,
+    LFO_WAVEFORM_COUNT
+};
+
+inline const char* lfoWaveformNames[] = {
+    "Sin", "Tri", "Saw", "Sqr", "S&H"
+};
+
+const int NUM_LFOS = 2;
+
+// LFO de control: avanza por tramos de samples y devuelve el valor (-1 a 1)
+// al final de cada tramo; el que lo usa interpola entre tramos.
 class LFO {
 private:
     double phase;
     double sampleRate;
+    double holdValue;
+    unsigned int seed;
+
+    double nextRandom() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 8388607.5 - 1.0;
+    }
 
 public:
-    LFO(double sr) : phase(0.0), sampleRate(sr) {}
+    LFO(double sr = DEFAULT_SAMPLE_RATE) : phase(0.0), sampleRate(sr), holdValue(0.0), seed(0x9E3779B9u) {}
+
+    void setSampleRate(double sr) { sampleRate = sr; }
+
+    double advance(double rate, int numSamples, int waveform) {
+        phase += rate * numSamples / sampleRate;
+        if (phase >= 1.0) {
+            phase -= std::floor(phase);
+            holdValue = nextRandom();
+        }
 
-    double process(double rate, double depth) {
-        double output = std::sin(phase * TWO_PI) * depth;
-        phase += rate / sampleRate;
-        if (phase >= 1.0) phase -= 1.0;
-        return output;
+        switch (waveform) {
+            case LFO_TRIANGLE:
+                return phase < 0.5 ? 4.0 * phase - 1.0 : 3.0 - 4.0 * phase;
+            case LFO_SAW:
+                return 2.0 * phase - 1.0;
+            case LFO_SQUARE:
+                return phase < 0.5 ? 1.0 : -1.0;
+            case LFO_SAMPLE_HOLD:
+                return holdValue;
+            default:
+                return tableSin(phase * TWO_PI);
+        }
     }
 
-    void reset() { phase = 0.0; }
+    // Key sync: reinicia la fase (y un valor nuevo para el S&H)
+    void reset() {
+        phase = 0.0;
+        holdValue = nextRandom();
+    }
 };
-
-// Helper para aplicar modulacion LFO
-inline float applyLfoMod(float baseValue, int target, int lfoTarget, float lfoValue, float minVal, float maxVal) {
-    if (target != lfoTarget || lfoTarget == LFO_OFF) return baseValue;
-    float range = maxVal - minVal;
-    return std::max(minVal, std::min(maxVal, baseValue + lfoValue * range * 0.5f));
-}
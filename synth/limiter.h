@@ -0,0 +1,165 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "constants.h"
+#include "dsp_tables.h"
+#include "denormals.h"
+
+// Bloqueador de DC: pasa-altos de un polo a ~10 Hz
+template <typename T>
+class DCBlocker {
+private:
+    T x1, y1;
+    T r;
+
+public:
+    DCBlocker(double sr) : x1(0), y1(0), r((T)exponentialDecay(TWO_PI * 10.0 / sr)) {}
+
+    void process(T* buffer, int numSamples) {
+        for (int i = 0; i < numSamples; i++) {
+            T y = buffer[i] - x1 + r * y1;
+            x1 = buffer[i];
+            y1 = y;
+            buffer[i] = y;
+        }
+        y1 = flushBelow(y1, (T)getDenormalFloor());
+    }
+
+    void reset() { x1 = y1 = 0; }
+
+    bool isStateZero() const { return x1 == 0 && y1 == 0; }
+};
+
+// Limitador de picos estereo (canales enlazados) con lookahead.
+// El maximo de la ventana se mantiene con una cola monotona (O(1) amortizado);
+// la ganancia minima de la ventana pasa por un release de un polo y por un
+// promedio movil del largo del lookahead, asi llega al objetivo justo cuando
+// el pico sale de la linea de retardo y nunca supera el techo.
+template <typename T>
+class LookaheadLimiter {
+private:
+    static constexpr double MIN_LOOKAHEAD_MS = 1.0;
+    static constexpr double MAX_LOOKAHEAD_MS = 5.0;
+
+    double sampleRate;
+    int lookahead;                      // samples de retardo (L)
+    int size;                           // potencia de dos > L
+    int mask;
+    int writeIndex;
+
+    std::vector<T> delayL, delayR;
+    std::vector<T> gainHistory;         // ultimas L ganancias para el promedio
+    double gainSum;
+
+    // Cola monotona de maximos: indices absolutos y picos decrecientes
+    std::vector<long long> maxIndex;
+    std::vector<T> maxValue;
+    int maxHead;
+    int maxTail;
+    long long sampleCount;
+
+    T ceiling;
+    T releaseCoeff;
+    T releaseGain;
+    T gains[MAX_BLOCK_SIZE];
+
+    void pushPeak(T p) {
+        while (maxTail != maxHead && maxValue[(maxTail - 1) & mask] <= p) {
+            maxTail = (maxTail - 1) & mask;
+        }
+        maxValue[maxTail] = p;
+        maxIndex[maxTail] = sampleCount;
+        maxTail = (maxTail + 1) & mask;
+        // La ventana cubre L + 1 samples: el actual y los L que estan en el retardo
+        while (maxIndex[maxHead] < sampleCount - lookahead) {
+            maxHead = (maxHead + 1) & mask;
+        }
+    }
+
+public:
+    LookaheadLimiter(double sr)
+        : sampleRate(sr), lookahead(0), writeIndex(0), gainSum(0.0),
+          maxHead(0), maxTail(0), sampleCount(0),
+          ceiling((T)dbToGain(-0.3)), releaseGain(1) {
+        int maxLookahead = (int)(MAX_LOOKAHEAD_MS * 0.001 * sr) + 1;
+        size = 1;
+        while (size <= maxLookahead + 1) size <<= 1;
+        mask = size - 1;
+        delayL.assign(size, (T)0);
+        delayR.assign(size, (T)0);
+        gainHistory.assign(size, (T)1);
+        maxIndex.assign(size, 0);
+        maxValue.assign(size, (T)0);
+        setRelease(50.0);
+        setLookahead(2.0);
+    }
+
+    // Lookahead en ms (1 a 5); cambiarlo vacia el estado
+    void setLookahead(double ms) {
+        ms = std::max(MIN_LOOKAHEAD_MS, std::min(MAX_LOOKAHEAD_MS, ms));
+        int samples = std::max(1, (int)(ms * 0.001 * sampleRate));
+        if (samples == lookahead) return;
+        lookahead = samples;
+        reset();
+    }
+
+    void setCeiling(double db) { ceiling = (T)dbToGain(std::min(0.0, db)); }
+    void setRelease(double ms) { releaseCoeff = (T)(1.0 - exponentialDecay(1.0 / (std::max(1.0, ms) * 0.001 * sampleRate))); }
+
+    int getLatency() const { return lookahead; }
+
+    void reset() {
+        std::fill(delayL.begin(), delayL.end(), (T)0);
+        std::fill(delayR.begin(), delayR.end(), (T)0);
+        std::fill(gainHistory.begin(), gainHistory.end(), (T)1);
+        gainSum = lookahead;
+        maxHead = maxTail = 0;
+        sampleCount = 0;
+        writeIndex = 0;
+        releaseGain = 1;
+    }
+
+    // Linea de retardo del lookahead exactamente en cero
+    bool isStateZero() const {
+        for (int i = 0; i < size; i++) {
+            if (delayL[i] != 0 || delayR[i] != 0) return false;
+        }
+        return true;
+    }
+
+    // Procesa in-place un bloque estereo (numSamples <= MAX_BLOCK_SIZE)
+    void process(T* left, T* right, int numSamples) {
+        const T invL = (T)1 / (T)lookahead;
+
+        // Pasada 1: curva de ganancia del bloque
+        for (int i = 0; i < numSamples; i++) {
+            pushPeak(std::max(std::fabs(left[i]), std::fabs(right[i])));
+            T peak = maxValue[maxHead];
+            T target = peak > ceiling ? ceiling / peak : (T)1;
+
+            // Ataque inmediato, release de un polo
+            releaseGain = target < releaseGain ? target : releaseGain + (target - releaseGain) * releaseCoeff;
+
+            int slot = (int)(sampleCount % lookahead);
+            gainSum += (double)releaseGain - (double)gainHistory[slot];
+            gainHistory[slot] = releaseGain;
+            gains[i] = (T)(gainSum * invL);
+            sampleCount++;
+        }
+
+        // Recalcular la suma una vez por bloque para que no acumule error
+        gainSum = 0.0;
+        for (int k = 0; k < lookahead; k++) gainSum += gainHistory[k];
+
+        // Pasada 2: retardo y ganancia
+        for (int i = 0; i < numSamples; i++) {
+            int readIndex = (writeIndex - lookahead) & mask;
+            delayL[writeIndex] = left[i];
+            delayR[writeIndex] = right[i];
+            left[i] = delayL[readIndex] * gains[i];
+            right[i] = delayR[readIndex] * gains[i];
+            writeIndex = (writeIndex + 1) & mask;
+        }
+    }
+};
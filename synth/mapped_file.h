@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+
+#ifdef _WIN32
+// Evitar choques de nombres con raylib (CloseWindow, DrawText, Rectangle...)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef NOGDI
+#define NOGDI
+#endif
+#ifndef NOUSER
+#define NOUSER
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Archivo mapeado en memoria, solo lectura
+class MappedFile {
+private:
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+public:
+    MappedFile() : data(nullptr), size(0) {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#endif
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) return false;
+
+        data = (const unsigned char*)ptr;
+        size = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    // Pide al sistema que lea por adelantado [offset, offset + length) sin
+    // bloquear: las paginas llegan antes de que el audio las toque
+    void prefetch(size_t offset, size_t length) const {
+        if (!data || offset >= size) return;
+        if (length > size - offset) length = size - offset;
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = (PVOID)(data + offset);
+        range.NumberOfBytes = length;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t start = offset & ~(page - 1);
+        madvise((void*)(data + start), length + (offset - start), MADV_WILLNEED);
+#endif
+    }
+
+    // Acceso disperso: sin lectura anticipada del archivo entero, solo se
+    // cargan las paginas que se tocan (o las pedidas con prefetch)
+    void adviseRandomAccess() const {
+#ifndef _WIN32
+        if (data) madvise((void*)data, size, MADV_RANDOM);
+#endif
+    }
+
+    bool isOpen() const { return data != nullptr; }
+    const unsigned char* getData() const { return data; }
+    size_t getSize() const { return size; }
+};
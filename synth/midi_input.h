@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include "engine.h"
+
+// Parser de mensajes MIDI crudos hacia el motor, con MPE (zona baja).
+// En modo MPE el canal 1 es el manager (bend global, rueda, aftertouch) y
+// los canales 2-16 llevan una nota cada uno con su bend, pressure y CC74.
+// Sin MPE todos los canales se tratan como el manager.
+template <typename T>
+class MidiInput {
+private:
+    static const int NUM_CHANNELS = 16;
+    static const int MANAGER_CHANNEL = 0;
+
+    SynthEngine<T>& engine;
+    bool mpe;
+    double managerBendRange;                            // semitonos
+    double channelExpression[NUM_CHANNELS][EXPR_LANE_COUNT];  // ultimo valor por canal
+
+    bool isMemberChannel(int channel) const { return mpe && channel != MANAGER_CHANNEL; }
+
+    void setChannelExpression(int channel, int lane, double value) {
+        channelExpression[channel][lane] = value;
+        engine.setNoteExpression(channel, -1, lane, value);
+    }
+
+public:
+    MidiInput(SynthEngine<T>& e) : engine(e), mpe(false), managerBendRange(2.0) {
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            for (int l = 0; l < EXPR_LANE_COUNT; l++) channelExpression[c][l] = 0.0;
+        }
+    }
+
+    void setMpeEnabled(bool enabled) { mpe = enabled; }
+
+    // Rango del bend del manager y del bend por nota, en semitonos
+    void setBendRanges(double managerSemitones, double noteSemitones) {
+        managerBendRange = managerSemitones;
+        engine.setNoteBendRange(noteSemitones);
+    }
+
+    // Un mensaje de canal completo (status + 1 o 2 bytes de datos)
+    void processMessage(const unsigned char* data, int size) {
+        if (size < 2 || !(data[0] & 0x80)) return;
+        const int type = data[0] & 0xF0;
+        const int channel = data[0] & 0x0F;
+        const int d1 = data[1] & 0x7F;
+        const int d2 = size > 2 ? data[2] & 0x7F : 0;
+
+        switch (type) {
+            case 0x90:
+                if (d2 > 0) {
+                    engine.noteOn(d1, d2 / 127.0, channel);
+                    // En MPE el controlador manda la expresion inicial antes del note on
+                    if (isMemberChannel(channel)) {
+                        for (int l = 0; l < EXPR_LANE_COUNT; l++) {
+                            engine.setNoteExpression(channel, d1, l, channelExpression[channel][l]);
+                        }
+                    }
+                    break;
+                }
+                engine.noteOff(d1, channel);
+                break;
+
+            case 0x80:
+                engine.noteOff(d1, channel);
+                break;
+
+            case 0xA0:      // aftertouch polifonico
+                engine.setNoteExpression(channel, d1, EXPR_PRESSURE, d2 / 127.0);
+                break;
+
+            case 0xD0:      // aftertouch de canal
+                if (isMemberChannel(channel)) {
+                    setChannelExpression(channel, EXPR_PRESSURE, d1 / 127.0);
+                } else {
+                    engine.setAftertouch(d1 / 127.0);
+                }
+                break;
+
+            case 0xE0: {    // pitch bend de 14 bits
+                double bend = std::max(-1.0, (((d2 << 7) | d1) - 8192) / 8191.0);
+                if (isMemberChannel(channel)) {
+                    setChannelExpression(channel, EXPR_PITCH_BEND, bend);
+                } else {
+                    engine.setPitchBend(bend * managerBendRange);
+                }
+                break;
+            }
+
+            case 0xB0:
+                if (d1 == 1) {
+                    engine.setModWheel(d2 / 127.0);
+                } else if (d1 == 74) {
+                    setChannelExpression(channel, EXPR_SLIDE, d2 / 127.0);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include "constants.h"
+#include "lfo.h"
+#include "triple_buffer.h"
+
+// Fuentes de modulacion (todas normalizadas: bipolares -1 a 1 o unipolares 0 a 1)
+enum ModSource {
+    MOD_SRC_LFO1 = 0,
+    MOD_SRC_LFO2,
+    MOD_SRC_MOD_ENV,
+    MOD_SRC_AMP_ENV,
+    MOD_SRC_VELOCITY,
+    MOD_SRC_KEY,            // -1 en C0, 0 en C5 (nota 60), +1 en la nota 120
+    MOD_SRC_AFTERTOUCH,
+    MOD_SRC_MOD_WHEEL,
+    MOD_SRC_PITCH_BEND,     // lanes MPE por nota
+    MOD_SRC_PRESSURE,
+    MOD_SRC_SLIDE,
+    MOD_SRC_COUNT
+};
+
+inline const char* modSourceNames[] = {
+    "LFO1", "LFO2", "ModEnv", "AmpEnv", "Vel", "Key", "AT", "Wheel",
+    "Bend", "Press", "Slide"
+};
+
+// Destinos: los parametros de voz primero, despues los del master
+enum ModDestination {
+    MOD_DST_RATIO1 = 0, MOD_DST_RATIO2, MOD_DST_RATIO3, MOD_DST_RATIO4,
+    MOD_DST_INDEX1, MOD_DST_INDEX2, MOD_DST_INDEX3, MOD_DST_INDEX4,
+    MOD_DST_PITCH,          // semitonos sobre la nota (vibrato)
+    MOD_DST_FILTER_CUT, MOD_DST_FILTER_Q,
+    MOD_DST_CHORUS, MOD_DST_REVERB,
+    MOD_DST_COUNT
+};
+
+const int MOD_DST_VOICE_COUNT = MOD_DST_PITCH + 1;
+
+inline const char* modDestinationNames[] = {
+    "Ratio1", "Ratio2", "Ratio3", "Ratio4",
+    "Index1", "Index2", "Index3", "Index4",
+    "Pitch", "Filter", "Res", "Chorus", "Reverb"
+};
+
+// Rango de cada destino; con amount 1 la fuente recorre la mitad del rango
+inline const double modDestinationMin[] = {
+    0.5, 0.5, 0.5, 0.5, 0.0, 0.0, 0.0, 0.0, -12.0, 100.0, 0.5, 0.0, 0.0
+};
+inline const double modDestinationMax[] = {
+    8.0, 8.0, 8.0, 8.0, 10.0, 10.0, 10.0, 10.0, 12.0, 8000.0, 8.0, 1.0, 1.0
+};
+
+inline double clampModDestination(int dst, double value) {
+    return std::max(modDestinationMin[dst], std::min(modDestinationMax[dst], value));
+}
+
+// Los paneles de LFO y mod envelope ocupan slots fijos de la matriz
+inline int lfoTargetDestination(int target) {
+    static const int destinations[] = {
+        -1,
+        MOD_DST_RATIO1, MOD_DST_RATIO2, MOD_DST_RATIO3, MOD_DST_RATIO4,
+        MOD_DST_INDEX1, MOD_DST_INDEX2, MOD_DST_INDEX3, MOD_DST_INDEX4,
+        MOD_DST_FILTER_CUT, MOD_DST_FILTER_Q, MOD_DST_CHORUS, MOD_DST_REVERB,
+        MOD_DST_PITCH
+    };
+    return target > LFO_OFF && target < LFO_TARGET_COUNT ? destinations[target] : -1;
+}
+
+inline int modEnvTargetDestination(int target) {
+    switch (target) {
+        case MODENV_INDEX1: return MOD_DST_INDEX1;
+        case MODENV_INDEX2: return MOD_DST_INDEX2;
+        case MODENV_INDEX3: return MOD_DST_INDEX3;
+        case MODENV_INDEX4: return MOD_DST_INDEX4;
+        case MODENV_FILTER_CUT: return MOD_DST_FILTER_CUT;
+        default: return -1;
+    }
+}
+
+const int MAX_MOD_ROUTES = 16;
+const int MOD_COLUMNS = NUM_VOICES + 1;    // una columna por voz y la del master
+
+// Matriz de modulacion rala.
+// El control edita una tabla de rutas (fuente, destino, amount) y publica por
+// triple buffer solo las activas, compiladas en arrays densos de indices y
+// escalas. El audio evalua el producto matriz-vector para todas las columnas
+// (voces) a la vez: fuentes y salidas en SoA [fuente][columna], sin ramas
+// por destino dentro del loop.
+class ModMatrix {
+private:
+    struct Route {
+        int source;
+        int destination;        // -1 = slot libre
+        double amount;
+    };
+
+    struct CompiledRoutes {
+        int source[MAX_MOD_ROUTES];
+        int destination[MAX_MOD_ROUTES];
+        double scale[MAX_MOD_ROUTES];       // amount * medio rango del destino
+        int count;
+    };
+
+    Route routes[MAX_MOD_ROUTES];
+    TripleBuffer<CompiledRoutes> compiled;
+
+    void publish() {
+        CompiledRoutes& c = compiled.writeBuffer();
+        c.count = 0;
+        for (int r = 0; r < MAX_MOD_ROUTES; r++) {
+            const Route& route = routes[r];
+            if (route.destination < 0 || route.amount == 0.0) continue;
+            int dst = route.destination;
+            c.source[c.count] = route.source;
+            c.destination[c.count] = dst;
+            c.scale[c.count] = route.amount * (modDestinationMax[dst] - modDestinationMin[dst]) * 0.5;
+            c.count++;
+        }
+        compiled.publish();
+    }
+
+public:
+    ModMatrix() {
+        for (Route& r : routes) r = Route{0, -1, 0.0};
+        publish();
+    }
+
+    // Hilo de control. dst = -1 libera el slot; solo publica si algo cambia.
+    void setRoute(int slot, int source, int destination, double amount) {
+        if (slot < 0 || slot >= MAX_MOD_ROUTES) return;
+        if (source < 0 || source >= MOD_SRC_COUNT || destination >= MOD_DST_COUNT) destination = -1;
+        Route& r = routes[slot];
+        if (r.source == source && r.destination == destination && r.amount == amount) return;
+        r = Route{source, destination, amount};
+        publish();
+    }
+
+    void clearRoute(int slot) { setRoute(slot, 0, -1, 0.0); }
+
+    // Hilo de audio. sources es [MOD_SRC_COUNT][MOD_COLUMNS] y offsets
+    // [MOD_DST_COUNT][MOD_COLUMNS]; se evaluan las primeras numColumns columnas.
+    // Devuelve false si no hay rutas (offsets queda en cero).
+    bool process(const double (*sources)[MOD_COLUMNS], double (*offsets)[MOD_COLUMNS], int numColumns) {
+        const CompiledRoutes& c = compiled.read();
+        for (int d = 0; d < MOD_DST_COUNT; d++) std::fill(offsets[d], offsets[d] + numColumns, 0.0);
+        for (int r = 0; r < c.count; r++) {
+            const double* src = sources[c.source[r]];
+            double* dst = offsets[c.destination[r]];
+            const double scale = c.scale[r];
+            for (int v = 0; v < numColumns; v++) dst[v] += scale * src[v];
+        }
+        return c.count > 0;
+    }
+};
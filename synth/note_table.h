@@ -0,0 +1,81 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include "constants.h"
+#include "tuning.h"
+#include "dsp_tables.h"
+
+enum VelocityCurve {
+    VEL_LINEAR = 0,
+    VEL_SOFT,           // raiz: mas volumen con toques suaves
+    VEL_HARD,           // cuadratica: hay que pegar fuerte
+    VEL_CURVE_COUNT
+};
+
+inline const char* velocityCurveNames[] = {
+    "Lin", "Soft", "Hard"
+};
+
+// Escalado por teclado y velocidad de un patch (estilo DX)
+struct KeyScaling {
+    double indexTracking;       // 0 = indice fijo; 1 = indice proporcional a 440 / frecuencia
+    double rateTracking;        // octavas de velocidad de envolvente por octava sobre el C4
+    double levelTracking;       // dB por octava respecto del C4 (nota 60)
+    int velocityCurve;
+    double velocitySensitivity; // 0 = la velocidad no cambia el nivel
+
+    KeyScaling()
+        : indexTracking(0.0), rateTracking(0.0), levelTracking(0.0),
+          velocityCurve(VEL_LINEAR), velocitySensitivity(0.0) {}
+};
+
+// Valores de una nota para el patch actual
+struct NoteEntry {
+    double frequency;           // Hz
+    double indexScale;          // multiplica los indices de modulacion
+    double rateScale;           // multiplica la velocidad de las envolventes
+    double levelScale;          // ganancia de la nota
+};
+
+// Tabla de 128 notas precalculada al cargar o editar el patch: el noteOn
+// solo copia valores y el escalado no cuesta nada por sample.
+class NoteTable {
+private:
+    NoteEntry notes[NUM_NOTES];
+    double velocityGain[128];
+
+    static double curve(int type, double v) {
+        switch (type) {
+            case VEL_SOFT: return std::sqrt(v);
+            case VEL_HARD: return v * v;
+            default: return v;
+        }
+    }
+
+public:
+    NoteTable() { build(KeyScaling(), Tuning()); }
+
+    // Las frecuencias salen de la afinacion. El indice sigue a la frecuencia
+    // real; rate y level siguen contando teclas desde el C4.
+    // Las notas sin frecuencia (teclas sin mapear) quedan en 0 y no suenan.
+    void build(const KeyScaling& k, const Tuning& tuning) {
+        for (int n = 0; n < NUM_NOTES; n++) {
+            double fromC4 = (n - 60) / 12.0;
+            NoteEntry& e = notes[n];
+            e.frequency = tuning.getFrequency(n);
+            e.indexScale = e.frequency > 0.0 ? std::pow(440.0 / e.frequency, k.indexTracking) : 1.0;
+            e.rateScale = tableExp2(k.rateTracking * fromC4);
+            e.levelScale = dbToGain(k.levelTracking * fromC4);
+        }
+        for (int v = 0; v < 128; v++) {
+            velocityGain[v] = 1.0 - k.velocitySensitivity + k.velocitySensitivity * curve(k.velocityCurve, v / 127.0);
+        }
+    }
+
+    const NoteEntry& operator[](int note) const { return notes[std::max(0, std::min(NUM_NOTES - 1, note))]; }
+
+    // velocity de 0 a 1
+    double velocity(double v) const {
+        return velocityGain[std::max(0, std::min(127, (int)(v * 127.0 + 0.5)))];
+    }
+};
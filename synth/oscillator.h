@@ -1,42 +1,251 @@
 #pragma once
 #include <cmath>
+#include <algorithm>
 #include "constants.h"
+#include "dsp_tables.h"
+#include "wavetable.h"
 
+// La fase se acumula siempre en double: en float deriva en notas largas
+template <typename T>
 class Oscillator {
 private:
     double phase;
     double phaseIncrement;
+    double incrementStep;       // rampa lineal del incremento hacia la frecuencia nueva
+    int rampSamples;
     double frequency;
     double sampleRate;
+    double radiansPerHz;        // TWO_PI / sampleRate: sin divisiones al cambiar la frecuencia
+    const Wavetable<T>* wavetable;  // nullptr = seno
+    int mipLevel;
+    // Estado de processFree: e^(i*fase) de los proximos 4 samples y su giro por grupo
+    double phasorRe[4], phasorIm[4];
+    double rotationRe[4], rotationIm[4];
+    double phasorStep;          // rampa con la que esta armado rotation
+    int phasorAge;              // tramos desde la ultima siembra; -1 = sin sembrar
 
 public:
     Oscillator(double freq, double sr)
-        : phase(0.0), frequency(freq), sampleRate(sr) {
+        : phase(0.0), incrementStep(0.0), rampSamples(0), frequency(freq), sampleRate(sr),
+          radiansPerHz(TWO_PI / sr), wavetable(nullptr), mipLevel(0),
+          phasorStep(0.0), phasorAge(-1) {
         updatePhaseIncrement();
     }
 
     void setFrequency(double freq) {
         frequency = freq;
+        rampSamples = 0;
+        phasorAge = -1;
         updatePhaseIncrement();
     }
 
+    // Llega a freq en numSamples samples (modulacion a control rate sin escalones)
+    void rampFrequency(double freq, int numSamples) {
+        frequency = freq;
+        const double target = radiansPerHz * freq;
+        incrementStep = (target - phaseIncrement) / numSamples;
+        rampSamples = numSamples;
+        mipLevel = wavetableLevel(std::max(target, phaseIncrement));
+    }
+
+    // Forma de onda limitada en banda; el nivel de mip sigue al incremento
+    void setWavetable(const Wavetable<T>* table) { wavetable = table; }
+
     double getFrequency() const { return frequency; }
 
-    double process(double modulation = 0.0) {
-        double output = std::sin(phase + modulation);
+    T process(T modulation = 0) {
+        T output = wavetable ? wavetable->read((T)phase + modulation, mipLevel)
+                             : tableSin((T)phase + modulation);
         phase += phaseIncrement;
         if (phase >= TWO_PI) {
             phase -= TWO_PI;
         }
+        if (rampSamples > 0) {
+            phaseIncrement += incrementStep;
+            if (--rampSamples == 0) updatePhaseIncrement();
+        }
+        phasorAge = -1;
         return output;
     }
 
+    // Sin entrada de modulacion: igual que numSamples llamadas a process(0),
+    // pero el seno sale de una recurrencia de fasores (sin libm por sample).
+    // Con tabla de onda no hay atajo y se lee sample a sample.
+    void processFree(T* out, int numSamples) {
+        if (wavetable) {
+            for (int i = 0; i < numSamples; i++) out[i] = process();
+            return;
+        }
+        int done = 0;
+        if (rampSamples > 0) {
+            const int n = std::min(numSamples, rampSamples);
+            rotate(out, n, incrementStep);
+            advanceRamp(n);
+            done = n;
+        }
+        if (done < numSamples) rotate(out + done, numSamples - done, 0.0);
+    }
+
+    // Avanza numSamples sin generar salida (operador podado): la fase y la
+    // rampa quedan como despues de numSamples llamadas a process()
+    void skip(int numSamples) {
+        int done = 0;
+        if (rampSamples > 0) {
+            const int n = std::min(numSamples, rampSamples);
+            advancePhase(n, incrementStep);
+            advanceRamp(n);
+            done = n;
+        }
+        if (done < numSamples) advancePhase(numSamples - done, 0.0);
+        phasorAge = -1;
+    }
+
     void reset() {
         phase = 0.0;
+        phasorAge = -1;
     }
 
 private:
+    static const int PHASOR_LANES = 4;
+    static const int PHASOR_RESEED = 32;        // tramos entre siembras desde la fase en double
+
+    // count samples de sin(fase) con el incremento subiendo step por sample, y
+    // la fase avanzada en forma cerrada. Cuatro fasores intercalados (SoA) sin
+    // dependencia entre si: z rota por R cada 4 samples y R por D = e^(i*16*step)
+    // para seguir la rampa. El estado sigue de un tramo al otro: solo se
+    // corrige R si cambia la rampa, y se vuelve a sembrar desde la fase en
+    // double cada PHASOR_RESEED tramos para que el error no se acumule.
+    void rotate(T* out, int count, double step) {
+        if (phasorAge < 0 || phasorAge >= PHASOR_RESEED || !retune(step)) seed(step);
+        phasorAge++;
+
+        double dRe, dIm;
+        unitPhasor(step, dRe, dIm);
+        for (int k = 0; k < 4; k++) {       // D = d^16
+            double re = dRe * dRe - dIm * dIm;
+            dIm = 2.0 * dRe * dIm;
+            dRe = re;
+        }
+        // En double: el estado pasa de un tramo al otro sin acumular redondeo
+        double zRe[PHASOR_LANES], zIm[PHASOR_LANES], rRe[PHASOR_LANES], rIm[PHASOR_LANES];
+        for (int k = 0; k < PHASOR_LANES; k++) {
+            zRe[k] = phasorRe[k];
+            zIm[k] = phasorIm[k];
+            rRe[k] = rotationRe[k];
+            rIm[k] = rotationIm[k];
+        }
+        const bool ramp = step != 0.0;      // sin rampa R queda fijo
+        int i = 0;
+        for (; i + PHASOR_LANES <= count; i += PHASOR_LANES) {
+            for (int k = 0; k < PHASOR_LANES; k++) {
+                out[i + k] = (T)zIm[k];
+                double re = zRe[k] * rRe[k] - zIm[k] * rIm[k];
+                zIm[k] = zRe[k] * rIm[k] + zIm[k] * rRe[k];
+                zRe[k] = re;
+            }
+            if (ramp) {
+                for (int k = 0; k < PHASOR_LANES; k++) {
+                    double re = rRe[k] * dRe - rIm[k] * dIm;
+                    rIm[k] = rRe[k] * dIm + rIm[k] * dRe;
+                    rRe[k] = re;
+                }
+            }
+        }
+        for (int k = 0; i + k < count; k++) out[i + k] = (T)zIm[k];
+        // Un tramo que no es multiplo de 4 deja las lanes corridas: se resiembra
+        if (i < count) phasorAge = -1;
+
+        // Renormalizacion a modulo 1 por Newton (sin raiz): 1/|z| ~ (3 - |z|^2) / 2
+        for (int k = 0; k < PHASOR_LANES; k++) {
+            const double zScale = 1.5 - 0.5 * (zRe[k] * zRe[k] + zIm[k] * zIm[k]);
+            const double rScale = 1.5 - 0.5 * (rRe[k] * rRe[k] + rIm[k] * rIm[k]);
+            phasorRe[k] = zRe[k] * zScale;
+            phasorIm[k] = zIm[k] * zScale;
+            rotationRe[k] = rRe[k] * rScale;
+            rotationIm[k] = rIm[k] * rScale;
+        }
+        phasorStep = step;
+        advancePhase(count, step);
+    }
+
+    // Fase en forma cerrada tras count samples con el incremento subiendo step por sample
+    void advancePhase(int count, double step) {
+        phase += count * phaseIncrement + step * ((double)count * (count - 1) / 2);
+        phase -= TWO_PI * std::floor(phase / TWO_PI);
+    }
+
+    void advanceRamp(int count) {
+        phaseIncrement += incrementStep * count;
+        rampSamples -= count;
+        if (rampSamples == 0) updatePhaseIncrement();
+    }
+
+    // Siembra desde la fase en double (libm: pasa una vez cada PHASOR_RESEED
+    // tramos). Los primeros 8 samples por la recurrencia escalar:
+    // z[k + 1] = z[k] * w[k], w[k + 1] = w[k] * d
+    void seed(double step) {
+        double seedRe[2 * PHASOR_LANES], seedIm[2 * PHASOR_LANES];
+        double wRe = std::cos(phaseIncrement), wIm = std::sin(phaseIncrement);
+        double dRe, dIm;
+        unitPhasor(step, dRe, dIm);
+        seedRe[0] = std::cos(phase);
+        seedIm[0] = std::sin(phase);
+        for (int k = 1; k < 2 * PHASOR_LANES; k++) {
+            seedRe[k] = seedRe[k - 1] * wRe - seedIm[k - 1] * wIm;
+            seedIm[k] = seedRe[k - 1] * wIm + seedIm[k - 1] * wRe;
+            double re = wRe * dRe - wIm * dIm;
+            wIm = wRe * dIm + wIm * dRe;
+            wRe = re;
+        }
+        for (int k = 0; k < PHASOR_LANES; k++) {
+            phasorRe[k] = seedRe[k];
+            phasorIm[k] = seedIm[k];
+            // R[k] = z[k + 4] * conj(z[k])
+            rotationRe[k] = seedRe[k + PHASOR_LANES] * seedRe[k] + seedIm[k + PHASOR_LANES] * seedIm[k];
+            rotationIm[k] = seedIm[k + PHASOR_LANES] * seedRe[k] - seedRe[k + PHASOR_LANES] * seedIm[k];
+        }
+        phasorAge = 0;
+        phasorStep = step;
+    }
+
+    // Cambio de rampa sin resembrar: z[k] = e^(i*(fase + k*inc + step*k(k - 1)/2))
+    // y R[k] = e^(i*(4*inc + step*(4k + 6))), asi que alcanza con girarlos por
+    // la diferencia de rampa. Si el salto es grande devuelve false y se
+    // siembra de nuevo.
+    bool retune(double step) {
+        const double delta = step - phasorStep;
+        if (delta == 0.0) return true;
+        if (std::fabs(delta) * (4 * PHASOR_LANES + 2) > 0.05) return false;
+        for (int k = 0; k < PHASOR_LANES; k++) {
+            rotateBy(phasorRe[k], phasorIm[k], delta * (k * (k - 1) / 2));
+            rotateBy(rotationRe[k], rotationIm[k], delta * (4 * k + 6));
+        }
+        return true;
+    }
+
+    static void rotateBy(double& re, double& im, double angle) {
+        double cRe, cIm;
+        unitPhasor(angle, cRe, cIm);
+        const double r = re * cRe - im * cIm;
+        im = re * cIm + im * cRe;
+        re = r;
+    }
+
+    // e^(i*angle): los pasos de rampa son chicos y van por Taylor (error
+    // angle^5 / 120, debajo del redondeo en double hasta 1e-3)
+    static void unitPhasor(double angle, double& re, double& im) {
+        if (std::fabs(angle) > 1e-3) {
+            re = std::cos(angle);
+            im = std::sin(angle);
+            return;
+        }
+        const double a2 = angle * angle;
+        re = 1.0 - a2 * 0.5 + a2 * a2 / 24.0;
+        im = angle * (1.0 - a2 / 6.0);
+    }
+
     void updatePhaseIncrement() {
-        phaseIncrement = TWO_PI * frequency / sampleRate;
+        phaseIncrement = radiansPerHz * frequency;
+        mipLevel = wavetableLevel(phaseIncrement);
     }
 };
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// Remuestreo offline (al cargar archivos) con sinc enventanado (Blackman).
+// Al bajar de frecuencia el corte baja con la relacion, asi lo que queda
+// sobre el nuevo Nyquist se filtra en vez de plegarse. El kernel se tabula
+// una vez y se interpola linealmente entre puntos de la tabla.
+inline std::vector<float> resampleWindowedSinc(const std::vector<float>& src, double fromRate, double toRate,
+                                               int maxLength) {
+    const double ratio = fromRate / toRate;         // samples de entrada por sample de salida
+    const int length = std::max(0, std::min(maxLength, (int)(src.size() / ratio)));
+    std::vector<float> out(length);
+    if (fromRate == toRate) {
+        std::copy(src.begin(), src.begin() + length, out.begin());
+        return out;
+    }
+
+    // Kernel en cruces por cero: ZEROS a cada lado, TABLE_STEPS puntos por cruce
+    const int ZEROS = 16;
+    const int TABLE_STEPS = 512;
+    const int tableSize = ZEROS * TABLE_STEPS;
+    std::vector<double> kernel(tableSize + 2, 0.0);
+    for (int j = 0; j <= tableSize; j++) {
+        const double x = (double)j / TABLE_STEPS;
+        const double u = M_PI * x / ZEROS;
+        const double window = 0.42 + 0.5 * std::cos(u) + 0.08 * std::cos(2.0 * u);
+        kernel[j] = (j == 0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x)) * window;
+    }
+
+    // Corte como fraccion del Nyquist de entrada, con margen para la banda de transicion
+    const double cutoff = std::min(1.0, toRate / fromRate) * 0.95;
+    const double halfWidth = ZEROS / cutoff;        // en samples de entrada
+    const int last = (int)src.size() - 1;
+    for (int i = 0; i < length; i++) {
+        const double t = i * ratio;
+        const int from = std::max(0, (int)std::ceil(t - halfWidth));
+        const int to = std::min(last, (int)std::floor(t + halfWidth));
+        double acc = 0.0;
+        for (int k = from; k <= to; k++) {
+            const double pos = std::fabs(t - k) * cutoff * TABLE_STEPS;
+            const int idx = (int)pos;
+            if (idx >= tableSize) continue;
+            const double frac = pos - idx;
+            acc += src[k] * (kernel[idx] + (kernel[idx + 1] - kernel[idx]) * frac);
+        }
+        out[i] = (float)(acc * cutoff);
+    }
+    return out;
+}
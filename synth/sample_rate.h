@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+
+// Frecuencias de muestreo soportadas por el motor
+const unsigned int SUPPORTED_SAMPLE_RATES[] = {44100, 48000, 88200, 96000, 192000};
+const int NUM_SUPPORTED_SAMPLE_RATES = 5;
+
+inline bool isSupportedSampleRate(unsigned int rate) {
+    for (int i = 0; i < NUM_SUPPORTED_SAMPLE_RATES; i++) {
+        if (SUPPORTED_SAMPLE_RATES[i] == rate) return true;
+    }
+    return false;
+}
+
+// Elige la frecuencia nativa del dispositivo si la soportamos, si no la mas
+// alta soportada que ofrezca el dispositivo, y como ultimo recurso 44.1 kHz
+inline unsigned int chooseSampleRate(const std::vector<unsigned int>& deviceRates, unsigned int preferred) {
+    if (isSupportedSampleRate(preferred)) return preferred;
+
+    unsigned int best = 0;
+    for (unsigned int rate : deviceRates) {
+        if (isSupportedSampleRate(rate) && rate > best) best = rate;
+    }
+    return best > 0 ? best : SUPPORTED_SAMPLE_RATES[0];
+}
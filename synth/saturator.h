@@ -0,0 +1,157 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include "constants.h"
+
+enum SaturationCurve {
+    SAT_TANH = 0,       // tanh racional (Pade 7/6)
+    SAT_CUBIC,          // polinomio cubico, rodilla mas suave
+    SAT_HARD,           // clip duro (conviene con oversampling)
+    SAT_CURVE_COUNT
+};
+
+inline const char* saturationCurveNames[] = {
+    "Tanh", "Cubic", "Hard"
+};
+
+// Aproximacion racional de tanh; error < 1e-4 y recortada a +-1 fuera de rango
+template <typename T>
+inline T fastTanh(T x) {
+    x = std::max((T)-4.97, std::min((T)4.97, x));
+    T x2 = x * x;
+    T num = x * ((T)135135 + x2 * ((T)17325 + x2 * ((T)378 + x2)));
+    T den = (T)135135 + x2 * ((T)62370 + x2 * ((T)3150 + x2 * (T)28));
+    return std::max((T)-1, std::min((T)1, num / den));
+}
+
+// x - 4/27 x^3 en [-1.5, 1.5]: llega a 1 con pendiente cero
+template <typename T>
+inline T cubicClip(T x) {
+    x = std::max((T)-1.5, std::min((T)1.5, x));
+    return x - (T)(4.0 / 27.0) * x * x * x;
+}
+
+template <typename T>
+inline T hardClip(T x) {
+    return std::max((T)-1, std::min((T)1, x));
+}
+
+// Saturacion por bloques de un canal, con oversampling 2x opcional.
+// El up/down usa un FIR de media banda polifasico; cada curva se aplica
+// en un loop sin ramas sobre todo el bloque para que el compilador lo vectorice.
+template <typename T>
+class Saturator {
+private:
+    static const int HALF_TAPS = 16;                // coeficientes no nulos por fase
+    static const int CENTER = HALF_TAPS / 2 - 1;    // retardo de la fase central
+
+    T coeffs[HALF_TAPS];                // taps pares del FIR, invertidos
+    T upHistory[2 * HALF_TAPS];         // buffer doble: ventana contigua siempre
+    T downHistory[2 * HALF_TAPS];       // muestras pares del oversampleado
+    T downCenter[2 * HALF_TAPS];        // muestras impares (fase central)
+    int upPos;
+    int downPos;
+
+    int curve;
+    T drive;
+    bool oversampling;
+    T work[2 * MAX_BLOCK_SIZE];
+
+    void shape(T* x, int numSamples) const {
+        const T g = drive;
+        switch (curve) {
+            case SAT_CUBIC:
+                for (int i = 0; i < numSamples; i++) x[i] = cubicClip(x[i] * g);
+                break;
+            case SAT_HARD:
+                for (int i = 0; i < numSamples; i++) x[i] = hardClip(x[i] * g);
+                break;
+            default:
+                for (int i = 0; i < numSamples; i++) x[i] = fastTanh(x[i] * g);
+                break;
+        }
+    }
+
+    static T dot(const T* a, const T* b) {
+        T acc = 0;
+        for (int k = 0; k < HALF_TAPS; k++) acc += a[k] * b[k];
+        return acc;
+    }
+
+public:
+    Saturator() : upPos(0), downPos(0), curve(SAT_TANH), drive(1), oversampling(false) {
+        // Media banda por sinc con ventana Blackman; los taps impares son cero
+        const int taps = 2 * HALF_TAPS - 1;
+        const int mid = taps / 2;
+        double sum = 0.0;
+        for (int i = 0; i < HALF_TAPS; i++) {
+            int j = 2 * i;                      // (j - mid) impar
+            double t = j - mid;
+            double w = 0.42 - 0.5 * std::cos(2.0 * 3.14159265358979 * j / (taps - 1))
+                     + 0.08 * std::cos(4.0 * 3.14159265358979 * j / (taps - 1));
+            double h = std::sin(0.5 * 3.14159265358979 * t) / (3.14159265358979 * t) * w;
+            coeffs[HALF_TAPS - 1 - i] = (T)h;
+            sum += h;
+        }
+        // La fase par suma exactamente 1/2 (ganancia DC unitaria)
+        for (int i = 0; i < HALF_TAPS; i++) coeffs[i] = (T)(coeffs[i] * 0.5 / sum);
+        reset();
+    }
+
+    void setCurve(int c) { curve = c; }
+    void setDrive(double d) { drive = (T)d; }
+    void setOversampling(bool enabled) {
+        if (enabled != oversampling) reset();
+        oversampling = enabled;
+    }
+
+    // Samples de retardo de la salida (solo con oversampling)
+    int getLatency() const { return oversampling ? 2 * CENTER + 1 : 0; }
+
+    void reset() {
+        std::fill(upHistory, upHistory + 2 * HALF_TAPS, (T)0);
+        std::fill(downHistory, downHistory + 2 * HALF_TAPS, (T)0);
+        std::fill(downCenter, downCenter + 2 * HALF_TAPS, (T)0);
+        upPos = downPos = 0;
+    }
+
+    bool isStateZero() const {
+        for (int i = 0; i < 2 * HALF_TAPS; i++) {
+            if (upHistory[i] != 0 || downHistory[i] != 0 || downCenter[i] != 0) return false;
+        }
+        return true;
+    }
+
+    // Procesa in-place (numSamples <= MAX_BLOCK_SIZE).
+    // Con oversampling la salida queda retardada 2 * CENTER + 1 samples.
+    void process(T* buffer, int numSamples) {
+        if (!oversampling) {
+            shape(buffer, numSamples);
+            return;
+        }
+
+        // Interpolar a 2x: fase par = FIR, fase impar = muestra retardada
+        for (int i = 0; i < numSamples; i++) {
+            upHistory[upPos] = buffer[i];
+            upHistory[upPos + HALF_TAPS] = buffer[i];
+            const T* window = upHistory + upPos + 1;
+            work[2 * i] = (T)2 * dot(coeffs, window);
+            work[2 * i + 1] = window[HALF_TAPS - 1 - CENTER];
+            upPos = (upPos + 1) % HALF_TAPS;
+        }
+
+        shape(work, 2 * numSamples);
+
+        // Filtrar y diezmar
+        for (int i = 0; i < numSamples; i++) {
+            downHistory[downPos] = work[2 * i];
+            downHistory[downPos + HALF_TAPS] = work[2 * i];
+            downCenter[downPos] = work[2 * i + 1];
+            downCenter[downPos + HALF_TAPS] = work[2 * i + 1];
+            const T* window = downHistory + downPos + 1;
+            const T* center = downCenter + downPos + 1;
+            buffer[i] = dot(coeffs, window) + (T)0.5 * center[HALF_TAPS - 2 - CENTER];
+            downPos = (downPos + 1) % HALF_TAPS;
+        }
+    }
+};
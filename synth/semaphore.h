@@ -0,0 +1,80 @@
+#pragma once
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef NOGDI
+#define NOGDI
+#endif
+#ifndef NOUSER
+#define NOUSER
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <cerrno>
+#include <semaphore.h>
+#endif
+
+// Semaforo del sistema para despertar un hilo de fondo desde el hilo de
+// audio: post() no toma locks ni espera (en Linux es un futex). Solo wait()
+// bloquea, y lo llama el hilo de fondo.
+class Semaphore {
+private:
+#if defined(_WIN32)
+    HANDLE handle;
+#elif defined(__APPLE__)
+    dispatch_semaphore_t handle;
+#else
+    sem_t handle;
+#endif
+
+public:
+    Semaphore() {
+#if defined(_WIN32)
+        handle = CreateSemaphoreA(nullptr, 0, 0x7fffffff, nullptr);
+#elif defined(__APPLE__)
+        handle = dispatch_semaphore_create(0);
+#else
+        sem_init(&handle, 0, 0);
+#endif
+    }
+
+    ~Semaphore() {
+#if defined(_WIN32)
+        CloseHandle(handle);
+#elif defined(__APPLE__)
+        dispatch_release(handle);
+#else
+        sem_destroy(&handle);
+#endif
+    }
+
+    Semaphore(const Semaphore&) = delete;
+    Semaphore& operator=(const Semaphore&) = delete;
+
+    void post() {
+#if defined(_WIN32)
+        ReleaseSemaphore(handle, 1, nullptr);
+#elif defined(__APPLE__)
+        dispatch_semaphore_signal(handle);
+#else
+        sem_post(&handle);
+#endif
+    }
+
+    void wait() {
+#if defined(_WIN32)
+        WaitForSingleObject(handle, INFINITE);
+#elif defined(__APPLE__)
+        dispatch_semaphore_wait(handle, DISPATCH_TIME_FOREVER);
+#else
+        while (sem_wait(&handle) != 0 && errno == EINTR) {}
+#endif
+    }
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+
+// Cola lock-free de un productor (control) y un consumidor (audio) con
+// capacidad fija. push() y pop() nunca bloquean ni reservan memoria; si la
+// cola esta llena push() devuelve false y el evento se pierde.
+template <typename T, int Capacity>
+class SpscQueue {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity tiene que ser potencia de 2");
+    static const int MASK = Capacity - 1;
+
+    T items[Capacity];
+    alignas(64) std::atomic<unsigned> head;    // proximo a leer, lo mueve el consumidor
+    alignas(64) std::atomic<unsigned> tail;    // proximo a escribir, lo mueve el productor
+
+public:
+    SpscQueue() : items(), head(0), tail(0) {}
+
+    bool push(const T& item) {
+        const unsigned t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= (unsigned)Capacity) return false;
+        items[t & MASK] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const unsigned h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & MASK];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cmath>
+
+const float SILENCE_THRESHOLD = 1e-5f;     // ~ -100 dBFS
+
+// Sigue si un efecto recibe silencio y si su cola interna ya decayo.
+// Cuando ambas cosas se cumplen durante tailLength samples el efecto
+// queda inactivo y puede saltear bloques enteros hasta que vuelva senal.
+class TailTracker {
+private:
+    int tailLength;
+    int silentSamples;
+    float threshold;
+    bool idle;
+
+public:
+    TailTracker(int tailSamples = 0, float thr = SILENCE_THRESHOLD)
+        : tailLength(tailSamples), silentSamples(0), threshold(thr), idle(false) {}
+
+    template <typename T>
+    static float peak(const T* buffer, int numSamples) {
+        float p = 0.0f;
+        for (int i = 0; i < numSamples; i++) {
+            float a = (float)std::fabs(buffer[i]);
+            p = a > p ? a : p;
+        }
+        return p;
+    }
+
+    void setTailLength(int samples) { tailLength = samples; }
+    void setThreshold(float thr) { threshold = thr; }
+
+    // Antes de procesar: true si el bloque se puede saltear
+    bool canSkip(float inputPeak) {
+        if (inputPeak > threshold) {
+            idle = false;
+            silentSamples = 0;
+        }
+        return idle;
+    }
+
+    // Despues de procesar: true justo cuando el efecto pasa a inactivo
+    // (momento de limpiar su estado para retomar limpio)
+    bool update(float inputPeak, float statePeak, int numSamples) {
+        if (inputPeak > threshold || statePeak > threshold) {
+            silentSamples = 0;
+            return false;
+        }
+        silentSamples += numSamples;
+        if (!idle && silentSamples >= tailLength) {
+            idle = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Forzar inactivo (por ejemplo con mix en cero)
+    void setIdle() {
+        idle = true;
+        silentSamples = tailLength;
+    }
+
+    bool isIdle() const { return idle; }
+};
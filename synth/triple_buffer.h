@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+
+// Triple buffer lock-free de un escritor (control) y un lector (audio).
+// El escritor llena writeBuffer() completo y llama a publish(); el lector
+// toma la ultima version publicada con read() sin bloquear nunca.
+template <typename T>
+class TripleBuffer {
+private:
+    static const int FRESH = 4;         // bit de "version nueva" junto al indice
+    static const int INDEX_MASK = 3;
+
+    T buffers[3];
+    std::atomic<int> middle;
+    int front;
+    int back;
+
+public:
+    TripleBuffer() : buffers(), middle(1), front(0), back(2) {}
+
+    T& writeBuffer() { return buffers[back]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return buffers[front];
+    }
+};
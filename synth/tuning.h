@@ -0,0 +1,206 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "constants.h"
+#include "dsp_tables.h"
+
+// Afinacion por archivos Scala: escala (.scl) y mapeo de teclado (.kbm).
+// Se parsea y se compila fuera del hilo de audio a una frecuencia por nota MIDI.
+// Sin archivos es temperamento igual de 12 notas con A4 = 440 Hz.
+class Tuning {
+private:
+    std::vector<double> degrees;        // cents de los grados 1..N (el ultimo es el periodo)
+
+    // Mapeo de teclado (.kbm); mapSize 0 = lineal, una tecla por grado
+    int mapSize;
+    int firstNote, lastNote;
+    int middleNote;                     // tecla del grado 0
+    int referenceNote;
+    double referenceFrequency;
+    int octaveDegree;                   // grado que hace de octava formal del mapeo
+    std::vector<int> mapping;           // -1 = tecla sin nota ("x")
+
+    double frequency[NUM_NOTES];
+
+    // Siguiente linea que no es comentario; false al final del archivo
+    static bool nextLine(std::istream& in, std::string& line) {
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] != '!') return true;
+        }
+        return false;
+    }
+
+    // "701.955" son cents; "3/2" o "2" son razones
+    static bool parsePitch(const std::string& line, double& cents) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) return false;
+        std::string token = line.substr(start, line.find_first_of(" \t", start) - start);
+        char* end = nullptr;
+        if (token.find('.') != std::string::npos) {
+            cents = std::strtod(token.c_str(), &end);
+            return end != token.c_str() && std::isfinite(cents);
+        }
+        long num = std::strtol(token.c_str(), &end, 10);
+        if (end == token.c_str() || num <= 0) return false;
+        long den = 1;
+        if (*end == '/') {
+            den = std::strtol(end + 1, &end, 10);
+            if (den <= 0) return false;
+        }
+        cents = 1200.0 * std::log2((double)num / (double)den);
+        return true;
+    }
+
+    static bool parseInt(std::istream& in, int& value) {
+        std::string line;
+        if (!nextLine(in, line)) return false;
+        char* end = nullptr;
+        value = (int)std::strtol(line.c_str(), &end, 10);
+        return end != line.c_str();
+    }
+
+    static bool isNote(int note) { return note >= 0 && note < NUM_NOTES; }
+
+    // Cents de un grado cualquiera (negativos o mas alla del periodo)
+    double degreeCents(int degree) const {
+        const int n = (int)degrees.size();
+        int period = degree >= 0 ? degree / n : -((-degree + n - 1) / n);
+        int step = degree - period * n;
+        return period * degrees[n - 1] + (step == 0 ? 0.0 : degrees[step - 1]);
+    }
+
+    // Grado de una tecla segun el mapeo; false si la tecla no suena
+    bool keyDegree(int note, int& degree) const {
+        if (note < firstNote || note > lastNote) return false;
+        int offset = note - middleNote;
+        if (mapSize == 0) {
+            degree = offset;
+            return true;
+        }
+        int pattern = offset >= 0 ? offset / mapSize : -((-offset + mapSize - 1) / mapSize);
+        int entry = mapping[offset - pattern * mapSize];
+        if (entry < 0) return false;
+        degree = entry + pattern * octaveDegree;
+        return true;
+    }
+
+    void compile() {
+        int refDegree = 0;
+        if (!keyDegree(referenceNote, refDegree)) refDegree = referenceNote - middleNote;
+        const double refCents = degreeCents(refDegree);
+        for (int note = 0; note < NUM_NOTES; note++) {
+            int degree;
+            frequency[note] = keyDegree(note, degree)
+                ? referenceFrequency * std::exp2((degreeCents(degree) - refCents) / 1200.0)
+                : 0.0;
+        }
+    }
+
+    // Mapeo por defecto: lineal, C4 (60) en el grado 0 y A4 (69) a 440 Hz
+    void setLinearMapping() {
+        mapSize = 0;
+        firstNote = 0;
+        lastNote = NUM_NOTES - 1;
+        middleNote = 60;
+        referenceNote = 69;
+        referenceFrequency = 440.0;
+        octaveDegree = (int)degrees.size();
+        mapping.clear();
+    }
+
+public:
+    // 12-TET: las frecuencias salen de la tabla constexpr, sin compilar nada
+    Tuning() {
+        for (int i = 1; i <= 12; i++) degrees.push_back(100.0 * i);
+        setLinearMapping();
+        std::copy(midiFrequencyTable<double>.begin(), midiFrequencyTable<double>.end(), frequency);
+    }
+
+    void resetKeyboardMapping() {
+        setLinearMapping();
+        compile();
+    }
+
+    bool loadScale(const char* path) {
+        std::ifstream in(path);
+        return in && loadScale(in);
+    }
+
+    bool loadKeyboardMapping(const char* path) {
+        std::ifstream in(path);
+        return in && loadKeyboardMapping(in);
+    }
+
+    // Los parsers leen linea por linea: un archivo corto o con una linea
+    // invalida se rechaza entero y la afinacion anterior queda como estaba
+    bool loadScale(std::istream& in) {
+        std::string line;
+        int count = 0;
+        if (!nextLine(in, line)) return false;      // descripcion
+        if (!parseInt(in, count) || count <= 0) return false;
+
+        std::vector<double> parsed;
+        while ((int)parsed.size() < count && nextLine(in, line)) {
+            double cents;
+            if (!parsePitch(line, cents)) return false;
+            parsed.push_back(cents);
+        }
+        if ((int)parsed.size() != count || parsed.back() <= 0.0) return false;
+
+        degrees = parsed;
+        if (mapSize == 0) octaveDegree = count;
+        compile();
+        return true;
+    }
+
+    bool loadKeyboardMapping(std::istream& in) {
+        int size, first, last, middle, reference, octave;
+        std::string line;
+        // Un mapeo mas largo que el teclado no tiene sentido: el limite evita
+        // reservar lo que diga un archivo roto
+        if (!parseInt(in, size) || size < 0 || size > NUM_NOTES) return false;
+        if (!parseInt(in, first) || !parseInt(in, last) || !isNote(first) || !isNote(last) || first > last) return false;
+        if (!parseInt(in, middle) || !parseInt(in, reference) || !isNote(middle) || !isNote(reference)) return false;
+        if (!nextLine(in, line)) return false;
+        double refFreq = std::strtod(line.c_str(), nullptr);
+        if (!(refFreq > 0.0) || !std::isfinite(refFreq)) return false;
+        if (!parseInt(in, octave) || octave < 0) return false;
+
+        // Cada entrada es un grado (entero >= 0) o "x" (tecla sin nota)
+        std::vector<int> entries;
+        while ((int)entries.size() < size && nextLine(in, line)) {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos) continue;
+            if (line[start] == 'x') {
+                entries.push_back(-1);
+                continue;
+            }
+            char* end = nullptr;
+            long degree = std::strtol(line.c_str() + start, &end, 10);
+            if (end == line.c_str() + start || degree < 0 || degree > INT_MAX) return false;
+            entries.push_back((int)degree);
+        }
+        // Las entradas que faltan al final quedan sin nota
+        entries.resize(size, -1);
+
+        mapSize = size;
+        firstNote = first;
+        lastNote = last;
+        middleNote = middle;
+        referenceNote = reference;
+        referenceFrequency = refFreq;
+        octaveDegree = octave > 0 ? octave : (int)degrees.size();
+        mapping = entries;
+        compile();
+        return true;
+    }
+
+    // 0 si la tecla no tiene nota en el mapeo
+    double getFrequency(int note) const { return frequency[note]; }
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include "constants.h"
+#include "dsp_tables.h"
+#include "wavetable.h"
+
+const int MAX_UNISON = 8;
+const int UNISON_CARRIERS = 3;      // op1, op2 y op3 pueden ser carriers
+
+// Copias desafinadas de los operadores carrier de una voz.
+// Cada carrier tiene hasta MAX_UNISON lanes contiguas; la modulacion se
+// calcula una sola vez y se suma a todas las lanes del stack.
+template <typename T>
+class UnisonBank {
+private:
+    double phase[UNISON_CARRIERS][MAX_UNISON];
+    double increment[UNISON_CARRIERS][MAX_UNISON];
+    double incrementStep[UNISON_CARRIERS][MAX_UNISON];
+    int rampSamples[UNISON_CARRIERS];
+    double detuneRatio[MAX_UNISON];
+    T prevSample[MAX_UNISON];           // feedback de op1 por lane
+    int lanes;
+    T laneGain;
+    double radiansPerHz;                // TWO_PI / sampleRate
+    const Wavetable<T>* wavetable[UNISON_CARRIERS];     // nullptr = seno
+    int mipLevel[UNISON_CARRIERS];      // por la lane mas aguda del stack
+
+    T oscillator(int carrier, T x) const {
+        return wavetable[carrier] ? wavetable[carrier]->read(x, mipLevel[carrier]) : tableSin(x);
+    }
+
+    void advanceRamp(int carrier) {
+        if (rampSamples[carrier] == 0) return;
+        for (int l = 0; l < lanes; l++) increment[carrier][l] += incrementStep[carrier][l];
+        rampSamples[carrier]--;
+    }
+
+public:
+    UnisonBank(double sr) : lanes(1), laneGain(1), radiansPerHz(TWO_PI / sr) {
+        for (int l = 0; l < MAX_UNISON; l++) detuneRatio[l] = 1.0;
+        for (int c = 0; c < UNISON_CARRIERS; c++) {
+            for (int l = 0; l < MAX_UNISON; l++) increment[c][l] = incrementStep[c][l] = 0.0;
+            rampSamples[c] = 0;
+            wavetable[c] = nullptr;
+            mipLevel[c] = 0;
+        }
+        reset();
+    }
+
+    // Cantidad de copias (1 a 8) y desafinacion total del stack en cents
+    void configure(int count, double detuneCents) {
+        lanes = count < 1 ? 1 : (count > MAX_UNISON ? MAX_UNISON : count);
+        for (int l = 0; l < lanes; l++) {
+            double spread = lanes > 1 ? 2.0 * l / (lanes - 1) - 1.0 : 0.0;
+            detuneRatio[l] = std::pow(2.0, spread * detuneCents * 0.5 / 1200.0);
+        }
+        // Las lanes no estan en fase: la suma crece como la raiz de N
+        laneGain = (T)(1.0 / std::sqrt((double)lanes));
+    }
+
+    int getLanes() const { return lanes; }
+
+    void setFrequency(int carrier, double freq) {
+        for (int l = 0; l < lanes; l++) {
+            increment[carrier][l] = radiansPerHz * freq * detuneRatio[l];
+        }
+        rampSamples[carrier] = 0;
+        mipLevel[carrier] = wavetableLevel(radiansPerHz * freq * detuneRatio[lanes - 1]);
+    }
+
+    void setWavetable(int carrier, const Wavetable<T>* table) { wavetable[carrier] = table; }
+
+    // Igual que Oscillator::rampFrequency para todas las lanes del carrier
+    void rampFrequency(int carrier, double freq, int numSamples) {
+        for (int l = 0; l < lanes; l++) {
+            double target = radiansPerHz * freq * detuneRatio[l];
+            incrementStep[carrier][l] = (target - increment[carrier][l]) / numSamples;
+        }
+        rampSamples[carrier] = numSamples;
+        const int top = lanes - 1;
+        mipLevel[carrier] = wavetableLevel(std::max(radiansPerHz * freq * detuneRatio[top], increment[carrier][top]));
+    }
+
+    // Fases iniciales fijas, elegidas para que el stack arranque con
+    // amplitud ~raiz de N (ni sumando en fase ni cancelandose)
+    void reset() {
+        static const double startPhase[MAX_UNISON] = {0.0, 0.75, 0.18, 0.82, 0.26, 0.8, 0.09, 0.2};
+        for (int l = 0; l < MAX_UNISON; l++) {
+            double offset = TWO_PI * startPhase[l];
+            for (int c = 0; c < UNISON_CARRIERS; c++) phase[c][l] = offset;
+            prevSample[l] = 0;
+        }
+    }
+
+    T process(int carrier, T modulation) {
+        T sum = 0;
+        for (int l = 0; l < lanes; l++) {
+            sum += oscillator(carrier, (T)phase[carrier][l] + modulation);
+            phase[carrier][l] += increment[carrier][l];
+            if (phase[carrier][l] >= TWO_PI) phase[carrier][l] -= TWO_PI;
+        }
+        advanceRamp(carrier);
+        return sum * laneGain;
+    }
+
+    // op1 con feedback propio en cada lane
+    T processFeedback(T modulation, T feedbackIndex) {
+        T sum = 0;
+        for (int l = 0; l < lanes; l++) {
+            T out = oscillator(0, (T)phase[0][l] + modulation + feedbackIndex * prevSample[l]);
+            prevSample[l] = out;
+            sum += out;
+            phase[0][l] += increment[0][l];
+            if (phase[0][l] >= TWO_PI) phase[0][l] -= TWO_PI;
+        }
+        advanceRamp(0);
+        return sum * laneGain;
+    }
+};
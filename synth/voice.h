@@ -1,10 +1,30 @@
 #pragma once
 #include <memory>
+#include <cmath>
+#include <algorithm>
 #include "fm_synth.h"
+#include "lfo.h"
 
+template <typename T>
 struct Voice {
-    std::unique_ptr<FMSynth> synth;
+    std::unique_ptr<FMSynth<T>> synth;
     int note;
+    int channel;        // canal MIDI de la nota (MPE: uno por nota)
+    double pan;         // -1 (izquierda) a 1 (derecha)
+    T gainL, gainR;
+    LFO lfo[NUM_LFOS];  // LFOs propios para el modo por voz
+    double velocity;    // fuentes de modulacion de la nota (0 a 1 y -1 a 1)
+    double key;
+    double glide;       // semitonos que faltan para llegar a la nota (portamento)
+    double glideRate;   // semitonos por segundo
 
-    Voice() : note(-1) {}
+    Voice() : note(-1), channel(0), pan(0.0), gainL(1), gainR(1), velocity(1.0), key(0.0), glide(0.0), glideRate(0.0) {}
+
+    // Potencia constante normalizada: en el centro ambos canales quedan en 1
+    void setPan(double p) {
+        pan = std::max(-1.0, std::min(1.0, p));
+        double angle = (pan + 1.0) * 0.25 * 3.14159265358979;
+        gainL = (T)(std::cos(angle) * 1.41421356237);
+        gainR = (T)(std::sin(angle) * 1.41421356237);
+    }
 };
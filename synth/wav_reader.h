@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Audio decodificado de un WAV: un vector float por canal
+struct WavData {
+    int sampleRate = 0;
+    int numChannels = 0;
+    std::vector<std::vector<float>> channels;
+
+    int getLength() const { return channels.empty() ? 0 : (int)channels[0].size(); }
+};
+
+inline uint32_t readLE32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint16_t readLE16(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Lee un WAV PCM 16/24/32 bits o float 32. El archivo se decodifica entero
+// de una vez, asi que se lee a memoria sin mapearlo.
+inline bool readWavFile(const char* path, WavData& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    const std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    const unsigned char* data = file.data();
+    size_t size = file.size();
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    int format = 0, channels = 0, bits = 0, rate = 0;
+    const unsigned char* samples = nullptr;
+    size_t samplesSize = 0;
+
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* chunk = data + pos;
+        size_t chunkSize = readLE32(chunk + 4);
+        const unsigned char* body = chunk + 8;
+        size_t available = size - pos - 8;
+        if (chunkSize > available) chunkSize = available;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+            format = readLE16(body);
+            channels = readLE16(body + 2);
+            rate = (int)readLE32(body + 4);
+            bits = readLE16(body + 14);
+            // WAVE_FORMAT_EXTENSIBLE: el formato real esta en el subformato
+            if (format == 0xFFFE && chunkSize >= 26) format = readLE16(body + 24);
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            samples = body;
+            samplesSize = chunkSize;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    bool pcm = (format == 1 && (bits == 16 || bits == 24 || bits == 32));
+    bool ieee = (format == 3 && bits == 32);
+    if (!samples || channels <= 0 || rate <= 0 || (!pcm && !ieee)) return false;
+
+    int bytesPerSample = bits / 8;
+    size_t frames = samplesSize / ((size_t)bytesPerSample * channels);
+
+    out.sampleRate = rate;
+    out.numChannels = channels;
+    out.channels.assign(channels, std::vector<float>(frames));
+
+    for (size_t i = 0; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            const unsigned char* p = samples + (i * channels + c) * bytesPerSample;
+            float v;
+            if (ieee) {
+                uint32_t raw = readLE32(p);
+                std::memcpy(&v, &raw, sizeof(v));
+            } else if (bits == 16) {
+                v = (int16_t)readLE16(p) / 32768.0f;
+            } else if (bits == 24) {
+                int32_t raw = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+                v = (raw >> 8) / 8388608.0f;
+            } else {
+                v = (int32_t)readLE32(p) / 2147483648.0f;
+            }
+            out.channels[c][i] = v;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "constants.h"
+#include "dsp_tables.h"
+#include "fft.h"
+#include "wav_reader.h"
+
+// Formas de onda de operador al estilo TX81Z: W1 es el seno, W2 el seno
+// "apretado" (sin * |sin|), W3 y W4 sus medias ondas positivas y W5-W8 las
+// mismas comprimidas en la primera mitad del ciclo. User es un ciclo cargado
+// de un WAV y Bank una tabla del banco mapeado (ver wavetable_bank.h).
+enum OperatorWaveform {
+    WAVE_W1 = 0,
+    WAVE_W2, WAVE_W3, WAVE_W4,
+    WAVE_W5, WAVE_W6, WAVE_W7, WAVE_W8,
+    WAVE_USER,
+    WAVE_BANK,
+    WAVE_COUNT
+};
+
+inline const char* operatorWaveformNames[] = {
+    "W1", "W2", "W3", "W4", "W5", "W6", "W7", "W8", "User", "Bank"
+};
+
+const int WAVETABLE_SIZE = 2048;                    // samples por ciclo
+const int WAVETABLE_LEVELS = 11;                    // 1024, 512, ... 1 armonicos
+const int WAVETABLE_MAX_HARMONIC = WAVETABLE_SIZE / 2;
+const int WAVETABLE_LEVEL_STRIDE = WAVETABLE_SIZE + 1;                          // con el sample de guarda
+const int WAVETABLE_STRIDE = WAVETABLE_LEVELS * WAVETABLE_LEVEL_STRIDE;         // samples por tabla
+
+// Nivel de mip para un incremento de fase (radianes por sample): el primero
+// cuyo armonico mas alto queda por debajo de Nyquist
+inline int wavetableLevel(double increment) {
+    const double harmonics = increment > 0.0 ? TWO_PI * 0.5 / increment : (double)WAVETABLE_MAX_HARMONIC;
+    int level = 0;
+    while (level < WAVETABLE_LEVELS - 1 && (WAVETABLE_MAX_HARMONIC >> level) > harmonics) level++;
+    return level;
+}
+
+// Un ciclo con sus niveles limitados en banda, calculados una vez por FFT.
+// Cada nivel tiene WAVETABLE_SIZE samples mas uno de guarda para interpolar.
+// Puede tener sus propios datos o ser una vista sobre un banco mapeado.
+template <typename T>
+class Wavetable {
+private:
+    std::vector<T> storage;
+    T* data;                            // storage, o nullptr si es una vista
+    const T* levels;                    // WAVETABLE_STRIDE samples
+
+public:
+    Wavetable() : storage((size_t)WAVETABLE_STRIDE, (T)0), data(storage.data()), levels(data) {}
+
+    // Vista sin copia sobre niveles ya calculados (banco mapeado)
+    explicit Wavetable(const T* precomputed) : data(nullptr), levels(precomputed) {}
+
+    // El buffer de un vector movido no cambia de lugar: los punteros siguen validos
+    Wavetable(Wavetable&& other) noexcept
+        : storage(std::move(other.storage)), data(other.data), levels(other.levels) {}
+    Wavetable(const Wavetable&) = delete;
+    Wavetable& operator=(const Wavetable&) = delete;
+
+    const T* getLevels() const { return levels; }
+
+    // Copia niveles ya calculados en otro tipo de sample (banco float en el motor double)
+    template <typename S>
+    void copyLevels(const S* source) {
+        if (!data) return;
+        for (int i = 0; i < WAVETABLE_STRIDE; i++) data[i] = (T)source[i];
+    }
+
+    // cycle tiene WAVETABLE_SIZE samples. Se saca el DC: en un carrier seria
+    // un salto con cada ataque de la envolvente. No se puede en una vista.
+    void build(const double* cycle) {
+        if (!data) return;
+        FFT<double> fft(WAVETABLE_SIZE);
+        std::vector<double> spectrumRe(cycle, cycle + WAVETABLE_SIZE);
+        std::vector<double> spectrumIm(WAVETABLE_SIZE, 0.0);
+        fft.forward(spectrumRe.data(), spectrumIm.data());
+        spectrumRe[0] = spectrumIm[0] = 0.0;
+
+        std::vector<double> re(WAVETABLE_SIZE), im(WAVETABLE_SIZE);
+        for (int level = 0; level < WAVETABLE_LEVELS; level++) {
+            const int maxHarmonic = WAVETABLE_MAX_HARMONIC >> level;
+            for (int k = 0; k < WAVETABLE_SIZE; k++) {
+                const int harmonic = k <= WAVETABLE_SIZE / 2 ? k : WAVETABLE_SIZE - k;
+                // Nyquist exacto (k = N/2) no tiene fase definida: fuera
+                const bool keep = harmonic < maxHarmonic || (harmonic == maxHarmonic && maxHarmonic < WAVETABLE_MAX_HARMONIC);
+                re[k] = keep ? spectrumRe[k] : 0.0;
+                im[k] = keep ? spectrumIm[k] : 0.0;
+            }
+            fft.inverse(re.data(), im.data());
+            T* out = data + (size_t)level * WAVETABLE_LEVEL_STRIDE;
+            for (int i = 0; i < WAVETABLE_SIZE; i++) out[i] = (T)re[i];
+            out[WAVETABLE_SIZE] = out[0];
+        }
+    }
+
+    // Un ciclo de cualquier largo, remuestreado a WAVETABLE_SIZE (interpolacion lineal)
+    void buildFromCycle(const float* samples, int length) {
+        std::vector<double> cycle(WAVETABLE_SIZE, 0.0);
+        if (length > 0) {
+            for (int i = 0; i < WAVETABLE_SIZE; i++) {
+                double position = (double)i * length / WAVETABLE_SIZE;
+                int i0 = (int)position;
+                double frac = position - i0;
+                cycle[i] = samples[i0] + frac * (samples[(i0 + 1) % length] - samples[i0]);
+            }
+        }
+        build(cycle.data());
+    }
+
+    // Igual que tableSin: x en radianes, cualquier signo
+    T read(T x, int level) const {
+        const T position = x * (T)(WAVETABLE_SIZE / TWO_PI);
+        int i = (int)position;
+        if (position < (T)i) i--;
+        const T frac = position - (T)i;
+        const T* t = levels + level * WAVETABLE_LEVEL_STRIDE + (i & (WAVETABLE_SIZE - 1));
+        return t[0] + frac * (t[1] - t[0]);
+    }
+};
+
+// Tablas TX81Z compartidas por todas las voces y motores. Se construyen en
+// la primera llamada, que tiene que venir del hilo de control. W1 devuelve
+// nullptr: el seno puro va por tableSin, sin tabla de mip.
+template <typename T>
+const Wavetable<T>* builtinWavetable(int waveform) {
+    static const std::vector<Wavetable<T>> tables = [] {
+        std::vector<Wavetable<T>> built(WAVE_USER);
+        std::vector<double> cycle(WAVETABLE_SIZE);
+        for (int w = WAVE_W2; w < WAVE_USER; w++) {
+            const int shape = w % 4;
+            const bool compressed = w >= WAVE_W5;
+            for (int i = 0; i < WAVETABLE_SIZE; i++) {
+                double phase = (double)i / WAVETABLE_SIZE;
+                if (compressed) {
+                    if (phase >= 0.5) { cycle[i] = 0.0; continue; }
+                    phase *= 2.0;
+                }
+                double s = std::sin(TWO_PI * phase);
+                double v = (shape & 1) ? s * std::fabs(s) : s;
+                cycle[i] = (shape & 2) ? std::max(0.0, v) : v;
+            }
+            built[w].build(cycle.data());
+        }
+        return built;
+    }();
+    return waveform > WAVE_W1 && waveform < WAVE_USER ? &tables[waveform] : nullptr;
+}
+
+// Un ciclo de usuario desde un WAV (primer canal, el archivo entero es un ciclo)
+template <typename T>
+bool loadWavetableFile(const char* path, Wavetable<T>& table) {
+    WavData wav;
+    if (!readWavFile(path, wav) || wav.getLength() < 2) return false;
+    table.buildFromCycle(wav.channels[0].data(), wav.getLength());
+    return true;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "mapped_file.h"
+#include "wav_reader.h"
+#include "wavetable.h"
+
+// Banco de wavetables (.fmwt), hecho para mapearse en memoria solo lectura:
+//   cabecera de 32 bytes: "FMWT", version, cantidad de tablas, samples por
+//   ciclo, niveles de mip y offset de los datos (uint32 little-endian)
+//   nombres: 32 bytes por tabla, terminados en cero
+//   datos (alineados a 64 bytes): por tabla WAVETABLE_STRIDE floats, los
+//   niveles ya limitados en banda tal como los lee Wavetable
+// Abrir un banco no lee los datos: las paginas se cargan al tocarlas o con
+// prefetch() al elegir una tabla en el patch.
+const uint32_t WAVETABLE_BANK_VERSION = 1;
+const int WAVETABLE_BANK_HEADER_SIZE = 32;
+const int WAVETABLE_BANK_NAME_SIZE = 32;
+const int WAVETABLE_BANK_ALIGN = 64;
+
+class WavetableBank {
+private:
+    MappedFile file;
+    int count;
+    const char* names;
+    const float* tables;
+
+    static size_t tableBytes() { return (size_t)WAVETABLE_STRIDE * sizeof(float); }
+
+public:
+    WavetableBank() : count(0), names(nullptr), tables(nullptr) {}
+
+    bool open(const char* path) {
+        count = 0;
+        if (!file.open(path)) return false;
+        const unsigned char* data = file.getData();
+        const size_t size = file.getSize();
+        if (size < (size_t)WAVETABLE_BANK_HEADER_SIZE || std::memcmp(data, "FMWT", 4) != 0) return false;
+
+        const uint32_t version = readLE32(data + 4);
+        const uint32_t tableCount = readLE32(data + 8);
+        const uint32_t cycleSize = readLE32(data + 12);
+        const uint32_t levels = readLE32(data + 16);
+        const uint32_t dataOffset = readLE32(data + 20);
+        // Los niveles se usan tal cual: tienen que coincidir con los del motor
+        if (version != WAVETABLE_BANK_VERSION || cycleSize != (uint32_t)WAVETABLE_SIZE ||
+            levels != (uint32_t)WAVETABLE_LEVELS || dataOffset % WAVETABLE_BANK_ALIGN != 0) {
+            return false;
+        }
+        const size_t namesEnd = WAVETABLE_BANK_HEADER_SIZE + (size_t)tableCount * WAVETABLE_BANK_NAME_SIZE;
+        if (tableCount == 0 || dataOffset < namesEnd || dataOffset + tableCount * tableBytes() > size) return false;
+
+        names = (const char*)data + WAVETABLE_BANK_HEADER_SIZE;
+        for (uint32_t t = 0; t < tableCount; t++) {
+            if (names[(t + 1) * WAVETABLE_BANK_NAME_SIZE - 1] != 0) return false;
+        }
+        tables = (const float*)(data + dataOffset);
+        count = (int)tableCount;
+        file.adviseRandomAccess();
+        return true;
+    }
+
+    int getCount() const { return count; }
+    const char* getName(int table) const { return names + table * WAVETABLE_BANK_NAME_SIZE; }
+    const float* getTable(int table) const { return tables + (size_t)table * WAVETABLE_STRIDE; }
+
+    // Pide las paginas de una tabla sin bloquear (al cargar el patch)
+    void prefetch(int table) const {
+        if (table < 0 || table >= count) return;
+        const size_t offset = (const unsigned char*)getTable(table) - file.getData();
+        file.prefetch(offset, tableBytes());
+    }
+};
+
+// Registro de bancos abiertos, compartido por todos los motores del proceso:
+// cada archivo se mapea una sola vez y se desmapea cuando nadie lo usa. Las
+// entradas de bancos ya liberados (y las de archivos que no abrieron) se
+// borran en cada apertura, asi el registro no crece con cada archivo probado.
+inline std::shared_ptr<const WavetableBank> openWavetableBank(const char* path) {
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<const WavetableBank>> banks;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = banks.begin(); it != banks.end();) {
+        it = it->second.expired() ? banks.erase(it) : std::next(it);
+    }
+    auto found = banks.find(path);
+    std::shared_ptr<const WavetableBank> bank = found != banks.end() ? found->second.lock() : nullptr;
+    if (bank) return bank;
+
+    auto opened = std::make_shared<WavetableBank>();
+    if (!opened->open(path)) return nullptr;
+    banks[path] = opened;
+    return opened;
+}
+
+// Tabla del banco para un motor de tipo T: en float es una vista sin copia
+// sobre el mapeo; en double (version de referencia) se convierte.
+template <typename T>
+std::unique_ptr<Wavetable<T>> makeBankWavetable(const WavetableBank& bank, int table) {
+    if constexpr (std::is_same<T, float>::value) {
+        return std::make_unique<Wavetable<T>>(bank.getTable(table));
+    } else {
+        auto copy = std::make_unique<Wavetable<T>>();
+        copy->copyLevels(bank.getTable(table));
+        return copy;
+    }
+}
+
+// Arma un banco a partir de WAVs. Un WAV cuyo largo es multiplo de
+// WAVETABLE_SIZE (y mayor) es multi-ciclo: cada cuadro es una tabla. Si no,
+// el archivo entero es un ciclo.
+inline bool writeWavetableBank(const char* path, const std::vector<std::string>& wavPaths) {
+    std::vector<std::string> names;
+    std::vector<float> data;
+    Wavetable<float> table;
+
+    for (const std::string& wavPath : wavPaths) {
+        WavData wav;
+        if (!readWavFile(wavPath.c_str(), wav) || wav.getLength() < 2) return false;
+        const float* samples = wav.channels[0].data();
+        const int length = wav.getLength();
+        const bool multiCycle = length > WAVETABLE_SIZE && length % WAVETABLE_SIZE == 0;
+        const int frames = multiCycle ? length / WAVETABLE_SIZE : 1;
+
+        std::string base = wavPath.substr(wavPath.find_last_of("/\\") + 1);
+        for (int f = 0; f < frames; f++) {
+            table.buildFromCycle(samples + f * (multiCycle ? WAVETABLE_SIZE : 0), multiCycle ? WAVETABLE_SIZE : length);
+            data.insert(data.end(), table.getLevels(), table.getLevels() + WAVETABLE_STRIDE);
+            names.push_back(multiCycle ? base + "#" + std::to_string(f + 1) : base);
+        }
+    }
+    if (names.empty()) return false;
+
+    const size_t namesEnd = WAVETABLE_BANK_HEADER_SIZE + names.size() * WAVETABLE_BANK_NAME_SIZE;
+    const size_t dataOffset = (namesEnd + WAVETABLE_BANK_ALIGN - 1) / WAVETABLE_BANK_ALIGN * WAVETABLE_BANK_ALIGN;
+    std::vector<unsigned char> header(dataOffset, 0);
+    auto writeLE32 = [&](size_t pos, uint32_t v) {
+        for (int b = 0; b < 4; b++) header[pos + b] = (unsigned char)(v >> (8 * b));
+    };
+    std::memcpy(header.data(), "FMWT", 4);
+    writeLE32(4, WAVETABLE_BANK_VERSION);
+    writeLE32(8, (uint32_t)names.size());
+    writeLE32(12, WAVETABLE_SIZE);
+    writeLE32(16, WAVETABLE_LEVELS);
+    writeLE32(20, (uint32_t)dataOffset);
+    for (size_t t = 0; t < names.size(); t++) {
+        std::strncpy((char*)&header[WAVETABLE_BANK_HEADER_SIZE + t * WAVETABLE_BANK_NAME_SIZE],
+                     names[t].c_str(), WAVETABLE_BANK_NAME_SIZE - 1);
+    }
+
+    // Los floats se escriben en el orden de bytes nativo (little-endian en x86 y ARM)
+    FILE* out = std::fopen(path, "wb");
+    if (!out) return false;
+    bool ok = std::fwrite(header.data(), 1, header.size(), out) == header.size() &&
+              std::fwrite(data.data(), sizeof(float), data.size(), out) == data.size();
+    ok = std::fclose(out) == 0 && ok;
+    return ok;
+}
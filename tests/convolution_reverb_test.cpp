@@ -0,0 +1,107 @@
+// Reverb por convolucion: la suma de cabeza (FIR directo), primeras
+// particiones y cola en el hilo de fondo tiene que dar lo mismo que la
+// convolucion directa con la IR. Ademas el remuestreo de la IR: un tono que
+// cae sobre el nuevo Nyquist se filtra y uno en la banda pasa intacto.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "synth/constants.h"
+#include "synth/convolution_reverb.h"
+#include "test_check.h"
+
+static const int TEST_SAMPLE_RATE = 48000;
+static const int IR_LENGTH = 5000;          // pasa LATE_START: usa las tres partes
+static const int INPUT_LENGTH = 12000;
+static const int BLOCK_FRAMES = 100;        // no divide a los bloques internos
+
+static std::vector<float> noise(int length, unsigned int seed, double decaySamples) {
+    std::vector<float> out(length);
+    for (int i = 0; i < length; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        out[i] = (float)(((seed >> 8) / 8388608.0 - 1.0) * std::exp(-i / decaySamples));
+    }
+    return out;
+}
+
+// Salida de la reverb (solo wet) contra la convolucion directa en double,
+// normalizada como la normaliza la reverb (energia 1 en el canal mas fuerte)
+static void checkPartitionedMatchesDirect() {
+    WavData wav;
+    wav.sampleRate = TEST_SAMPLE_RATE;
+    wav.numChannels = 2;
+    wav.channels = {noise(IR_LENGTH, 7, 1500.0), noise(IR_LENGTH, 11, 800.0)};
+    const std::vector<float> input[2] = {noise(INPUT_LENGTH, 3, 1e9), noise(INPUT_LENGTH, 5, 1e9)};
+
+    ConvolutionReverb<Sample> reverb(TEST_SAMPLE_RATE);
+    checkTrue("la IR carga", reverb.setImpulseResponse(wav));
+    reverb.setMix(1.0);
+
+    std::vector<double> output[2];
+    Sample left[BLOCK_FRAMES], right[BLOCK_FRAMES];
+    for (int start = 0; start < INPUT_LENGTH; start += BLOCK_FRAMES) {
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            left[i] = (Sample)input[0][start + i];
+            right[i] = (Sample)input[1][start + i];
+        }
+        reverb.process(left, right, BLOCK_FRAMES);
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            output[0].push_back(left[i]);
+            output[1].push_back(right[i]);
+        }
+        // Mas lento que el bloque de cola: el hilo de fondo siempre llega
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    }
+    checkTrue("el hilo de fondo entrega toda la cola", reverb.getLateOverruns() == 0);
+
+    double energy = 0.0;
+    for (const std::vector<float>& ch : wav.channels) {
+        double e = 0.0;
+        for (float v : ch) e += (double)v * v;
+        energy = std::max(energy, e);
+    }
+    const double norm = 1.0 / std::sqrt(energy);
+
+    double maxDiff = 0.0, peak = 0.0;
+    for (int c = 0; c < 2; c++) {
+        for (int n = 0; n < INPUT_LENGTH; n++) {
+            double expected = 0.0;
+            for (int k = 0; k <= std::min(n, IR_LENGTH - 1); k++) expected += wav.channels[c][k] * (double)input[c][n - k];
+            expected *= norm;
+            maxDiff = std::max(maxDiff, std::fabs(output[c][n] - expected));
+            peak = std::max(peak, std::fabs(expected));
+        }
+    }
+    checkBelow("particionada contra directa, diferencia / pico", maxDiff / peak, 1e-5);
+}
+
+// Pico de un seno remuestreado, lejos de los bordes (donde el kernel queda cortado)
+static double resampledPeak(double hz, int fromRate, int toRate, double& error) {
+    std::vector<float> src(fromRate / 4);
+    for (size_t i = 0; i < src.size(); i++) src[i] = (float)std::sin(2.0 * M_PI * hz * i / fromRate);
+    const std::vector<float> out = resampleWindowedSinc(src, fromRate, toRate, 1 << 30);
+    double peak = 0.0;
+    error = 0.0;
+    for (size_t i = 200; i + 200 < out.size(); i++) {
+        peak = std::max(peak, (double)std::fabs(out[i]));
+        error = std::max(error, std::fabs(out[i] - std::sin(2.0 * M_PI * hz * i / toRate)));
+    }
+    return peak;
+}
+
+static void checkResampler() {
+    double error = 0.0;
+    resampledPeak(1000.0, 44100, 48000, error);
+    checkBelow("1 kHz de 44.1 a 48 kHz, error", error, 1e-3);
+    resampledPeak(5000.0, 96000, 48000, error);
+    checkBelow("5 kHz de 96 a 48 kHz, error", error, 1e-3);
+    // Con interpolacion lineal 30 kHz se plegaria a 18 kHz casi sin atenuar
+    checkBelow("30 kHz de 96 a 48 kHz, pico del alias", resampledPeak(30000.0, 96000, 48000, error), 1e-3);
+}
+
+int main() {
+    checkPartitionedMatchesDirect();
+    checkResampler();
+    return testResult();
+}
@@ -0,0 +1,247 @@
+// Benchmark de regresion del modo denormal-safe: un golpe fuerte con filtro
+// y las dos reverbs, y despues varios segundos de silencio. Corre con el
+// guard de FTZ/DAZ y sin el: sin guard solo el piso de flush (flushBelow)
+// evita los subnormales, que multiplican el costo por bloque por 10-50.
+// Mientras las colas decaen el costo no puede dispararse y al final el
+// estado de las reverbs, el filtro y las envolventes queda en cero exacto.
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "synth/fm_synth.h"
+#include "synth/note_table.h"
+#include "synth/filter.h"
+#include "synth/effects.h"
+#include "synth/fdn_reverb.h"
+#include "synth/envelope.h"
+#include "synth/denormals.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 256;
+static const int BURST_VOICES = 8;
+static const double BURST_SECONDS = 1.0;
+static const double SILENCE_SECONDS = 8.0;
+static const int RUNS = 3;
+
+static double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)(p * (values.size() - 1));
+    return values[i];
+}
+
+static double sum(const std::vector<double>& values) {
+    double total = 0.0;
+    for (double v : values) total += v;
+    return total;
+}
+
+// Bloques chicos hasta que la respuesta al impulso de un filtro resonante
+// sale en cero exacto
+static int filterBlocksToZero() {
+    const int frames = 32;
+    Filter<Sample> filter(TEST_SAMPLE_RATE);
+    filter.setLowPass(300.0, 4.0);
+    Sample left[frames] = {1};
+    Sample right[frames] = {1};
+    for (int b = 0; b < 10000; b++) {
+        filter.process(left, right, frames);
+        bool zero = true;
+        for (int i = 0; i < frames; i++) zero = zero && left[i] == 0 && right[i] == 0;
+        if (zero) return b;
+        std::fill(left, left + frames, (Sample)0);
+        std::fill(right, right + frames, (Sample)0);
+    }
+    return -1;
+}
+
+// Samples de release hasta que la envolvente queda inactiva
+static int envelopeReleaseSamples() {
+    ADSREnvelope<Sample> envelope(TEST_SAMPLE_RATE);
+    envelope.setAttack(0.001);
+    envelope.setDecay(0.001);
+    envelope.setSustain(1.0);
+    envelope.setRelease(0.1);
+    envelope.noteOn();
+    for (int i = 0; i < 1000; i++) envelope.process();
+    envelope.noteOff();
+    int samples = 0;
+    while (envelope.isActive() && samples < 100000) {
+        envelope.process();
+        samples++;
+    }
+    return samples;
+}
+
+// Chequeo directo del piso (sin guard): con un piso alto el estado tiene que
+// llegar a cero antes que con el normal. Si flushBelow o la comparacion con
+// el piso dejan de aplicarse, el tail tracker sigue limpiando las colas y
+// los tiempos no lo muestran, pero esto si.
+static void checkFlushFloor() {
+    checkTrue("flushBelow lleva a cero lo que esta bajo el piso",
+              flushBelow(1e-20, 1e-15) == 0.0 && flushBelow(-1e-20f, 1e-15f) == 0.0f &&
+              flushBelow(0.5, 1e-15) == 0.5 && flushBelow(-0.5f, 1e-15f) == -0.5f);
+
+    const float defaultFloor = getDenormalFloor();
+    const int filterBlocks = filterBlocksToZero();
+    const int envelopeSamples = envelopeReleaseSamples();
+    setDenormalFloor(1e-4f);            // sobre el umbral del tail tracker (1e-5)
+    const int filterBlocksHigh = filterBlocksToZero();
+    setDenormalFloor(0.5f);
+    const int envelopeSamplesHigh = envelopeReleaseSamples();
+    setDenormalFloor(defaultFloor);
+
+    std::printf("filtro en cero: %d bloques (piso normal), %d (piso 1e-4); release: %d samples, %d (piso 0.5)\n",
+                filterBlocks, filterBlocksHigh, envelopeSamples, envelopeSamplesHigh);
+    checkTrue("el filtro llega a cero", filterBlocks > 0 && filterBlocksHigh > 0);
+    checkTrue("el piso vacia el estado del filtro", filterBlocksHigh < filterBlocks);
+    // Release lineal desde 1: con piso 0.5 termina a la mitad del tiempo
+    checkBelow("release con piso 0.5 / mitad del release",
+               std::fabs(envelopeSamplesHigh - 0.5 * envelopeSamples) / (0.5 * envelopeSamples), 0.01);
+}
+
+// Voces -> filtro -> Schroeder -> FDN, como el callback de la GUI
+struct Chain {
+    std::unique_ptr<FMSynth<Sample>> voices[BURST_VOICES];
+    Filter<Sample> filter;
+    AtmosphericReverb<Sample> reverb;
+    FDNReverb<Sample> fdnReverb;
+    Sample voiceBuffer[BLOCK_FRAMES];
+    Sample mono[BLOCK_FRAMES];
+    Sample left[BLOCK_FRAMES];
+    Sample right[BLOCK_FRAMES];
+
+    Chain() : filter(TEST_SAMPLE_RATE), reverb(TEST_SAMPLE_RATE), fdnReverb(TEST_SAMPLE_RATE) {
+        filter.setLowPass(2000.0, 0.9);
+        reverb.setMix(0.5);
+        fdnReverb.setMix(0.3);
+        for (int v = 0; v < BURST_VOICES; v++) {
+            voices[v] = std::make_unique<FMSynth<Sample>>(440.0, TEST_SAMPLE_RATE);
+            voices[v]->setAttack(0.005);
+            voices[v]->setRelease(0.3);
+            voices[v]->setIndex2(4.0);
+        }
+    }
+
+    void renderBlock() {
+        std::fill(mono, mono + BLOCK_FRAMES, (Sample)0);
+        for (int v = 0; v < BURST_VOICES; v++) {
+            voices[v]->render(voiceBuffer, BLOCK_FRAMES);
+            for (int i = 0; i < BLOCK_FRAMES; i++) mono[i] += voiceBuffer[i] * (Sample)0.3;
+        }
+        std::copy(mono, mono + BLOCK_FRAMES, left);
+        std::copy(mono, mono + BLOCK_FRAMES, right);
+        filter.process(left, right, BLOCK_FRAMES);
+        reverb.process(left, right, BLOCK_FRAMES);
+        fdnReverb.process(left, right, BLOCK_FRAMES);
+    }
+
+    bool isStateZero() const {
+        for (int v = 0; v < BURST_VOICES; v++) {
+            if (voices[v]->getEnvelopeLevel() != 0.0) return false;
+        }
+        return filter.isStateZero() && reverb.isStateZero() && fdnReverb.isStateZero();
+    }
+};
+
+// Tiempo de cada bloque en microsegundos
+static std::vector<double> renderTimed(Chain& chain, double seconds, double& peak) {
+    std::vector<double> times;
+    const int blocks = (int)(seconds * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    for (int b = 0; b < blocks; b++) {
+        auto start = std::chrono::steady_clock::now();
+        chain.renderBlock();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        for (int i = 0; i < BLOCK_FRAMES; i++) peak = std::max(peak, (double)std::max(std::fabs(chain.left[i]), std::fabs(chain.right[i])));
+    }
+    return times;
+}
+
+// Minimo por bloque entre corridas: un corte del scheduler casi nunca cae
+// en el mismo bloque de todas, los subnormales si
+static void keepFastest(std::vector<double>& fastest, const std::vector<double>& times) {
+    if (fastest.empty()) fastest = times;
+    for (size_t i = 0; i < fastest.size(); i++) fastest[i] = std::min(fastest[i], times[i]);
+}
+
+struct RunResult {
+    std::vector<double> burst;
+    std::vector<double> silence;
+    double peak = 0.0;
+    double silencePeak = 0.0;
+    double tailPeak = 0.0;
+    bool stateZero = false;
+};
+
+static RunResult runScenario(bool useGuard) {
+    std::unique_ptr<ScopedDenormalGuard> guard;
+    if (useGuard) guard = std::make_unique<ScopedDenormalGuard>();
+    auto chain = std::make_unique<Chain>();
+
+    // Calentamiento: paginas de las lineas de retardo y caches
+    RunResult r;
+    renderTimed(*chain, 0.5, r.peak);
+
+    const int notes[] = {36, 43, 48, 55, 60, 64, 67, 72};
+    const NoteTable table;
+    for (int v = 0; v < BURST_VOICES; v++) chain->voices[v]->noteOn(table[notes[v]], table.velocity(1.0));
+    r.peak = 0.0;
+    r.burst = renderTimed(*chain, BURST_SECONDS, r.peak);
+    for (int v = 0; v < BURST_VOICES; v++) chain->voices[v]->noteOff();
+    r.silence = renderTimed(*chain, SILENCE_SECONDS, r.silencePeak);
+
+    renderTimed(*chain, 0.5, r.tailPeak);
+    r.stateZero = chain->isStateZero();
+    return r;
+}
+
+// Chequeos de un modo; devuelve el costo total del silencio
+static double checkMode(const char* name, bool useGuard) {
+    std::vector<double> burst, silence;
+    bool sounds = true, tailSounds = true, tailZero = true, stateZero = true;
+    for (int run = 0; run < RUNS; run++) {
+        RunResult r = runScenario(useGuard);
+        keepFastest(burst, r.burst);
+        keepFastest(silence, r.silence);
+        sounds = sounds && r.peak > 0.1;
+        tailSounds = tailSounds && r.silencePeak > 1e-3;
+        tailZero = tailZero && r.tailPeak == 0.0;
+        stateZero = stateZero && r.stateZero;
+    }
+
+    const double burstMedian = percentile(burst, 0.5);
+    std::printf("%s, bloque de %d frames, minimo de %d corridas: golpe p50 %.1f us; silencio p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                name, BLOCK_FRAMES, RUNS, burstMedian, percentile(silence, 0.5), percentile(silence, 0.99),
+                percentile(silence, 1.0));
+    checkTrue("el golpe suena", sounds);
+    checkTrue("la cola de la reverb suena", tailSounds);
+
+    // El p99 deja afuera lo que quede de los cortes del scheduler; un bloque
+    // de cola no puede costar mas que uno con las 8 notas sonando
+    checkBelow("silencio p99 / golpe p50", percentile(silence, 0.99) / burstMedian, 1.5);
+
+    // Mientras las colas decaen el costo solo puede bajar: ninguna ventana
+    // de medio segundo cuesta mas que la primera (release de las voces)
+    const size_t window = (size_t)(0.5 * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    const double firstWindow = sum(std::vector<double>(silence.begin(), silence.begin() + window));
+    double worstWindow = 0.0;
+    for (size_t w = window; w + window <= silence.size(); w += window) {
+        worstWindow = std::max(worstWindow, sum(std::vector<double>(silence.begin() + w, silence.begin() + w + window)));
+    }
+    checkBelow("peor ventana / primera ventana", worstWindow / firstWindow, 1.5);
+
+    checkTrue("el final del silencio sale en cero exacto", tailZero);
+    checkTrue("reverbs, filtro y envolventes en cero", stateZero);
+    return sum(silence);
+}
+
+int main() {
+    checkFlushFloor();
+    const double guarded = checkMode("con FTZ/DAZ", true);
+    const double unguarded = checkMode("sin FTZ/DAZ", false);
+    // Sin guard la cola no puede costar mas: el piso de flush tiene que
+    // llevar todo a cero antes de que aparezca un subnormal
+    checkBelow("silencio sin guard / con guard", unguarded / guarded, 1.5);
+    return testResult();
+}
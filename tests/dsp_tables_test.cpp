@@ -0,0 +1,74 @@
+// Las tablas de dsp_tables.h contra libm en todo su dominio: el seno por
+// tabla, 2^x y sus conversiones (semitonos, dB, e^-x) y la tabla MIDI.
+// Los limites son los que declaran los comentarios del header.
+#include <algorithm>
+#include <cmath>
+#include "synth/dsp_tables.h"
+#include "test_check.h"
+
+static const int SWEEP_POINTS = 2000000;
+
+// Barrido de [from, to] con un paso que no cae sobre la grilla de la tabla.
+// relative: error relativo al valor de referencia en vez de absoluto
+template <typename Table, typename Reference>
+static double sweepError(double from, double to, bool relative, Table table, Reference reference) {
+    const double step = (to - from) / (SWEEP_POINTS - 1) * 0.999999937;
+    double worst = 0.0;
+    for (int i = 0; i < SWEEP_POINTS; i++) {
+        const double x = from + i * step;
+        const double expected = reference(x);
+        double error = std::fabs(table(x) - expected);
+        if (relative) error /= std::fabs(expected);
+        worst = std::max(worst, error);
+    }
+    return worst;
+}
+
+int main() {
+    // Seno: el double se barre en +-1000 rad (muchos ciclos, fase negativa
+    // incluida); el float en +-4 pi, el rango de fase que usan los osciladores
+    const double sinDouble = sweepError(-1000.0, 1000.0, false,
+                                        [](double x) { return tableSin(x); },
+                                        [](double x) { return std::sin(x); });
+    checkBelow("tableSin<double> error absoluto", sinDouble, 3e-7);
+    const double sinFloat = sweepError(-2.0 * TWO_PI, 2.0 * TWO_PI, false,
+                                       [](double x) { return (double)tableSin((float)x); },
+                                       [](double x) { return std::sin((double)(float)x); });
+    checkBelow("tableSin<float> error absoluto", sinFloat, 1e-6);
+
+    // 2^x en todo el rango util de ldexp para el audio
+    const double exp2Error = sweepError(-60.0, 60.0, true,
+                                        [](double x) { return tableExp2(x); },
+                                        [](double x) { return std::exp2(x); });
+    checkBelow("tableExp2 error relativo", exp2Error, 1e-7);
+
+    // Bend, transposicion y unison: +-10 octavas
+    const double ratioError = sweepError(-120.0, 120.0, true,
+                                         [](double s) { return semitonesToRatio(s); },
+                                         [](double s) { return std::pow(2.0, s / 12.0); });
+    checkBelow("semitonesToRatio error relativo", ratioError, 1e-7);
+
+    // Faders, ceiling del limitador y piso de las colas
+    const double gainError = sweepError(-200.0, 40.0, true,
+                                        [](double db) { return dbToGain(db); },
+                                        [](double db) { return std::pow(10.0, db / 20.0); });
+    checkBelow("dbToGain error relativo", gainError, 1e-7);
+
+    // Coeficientes de envolventes: de ataques instantaneos a colas largas
+    const double decayError = sweepError(0.0, 40.0, true,
+                                         [](double x) { return exponentialDecay(x); },
+                                         [](double x) { return std::exp(-x); });
+    checkBelow("exponentialDecay error relativo", decayError, 1e-7);
+
+    // Tabla MIDI constexpr: las 128 notas
+    double midiDouble = 0.0, midiFloat = 0.0;
+    for (int n = 0; n < NUM_NOTES; n++) {
+        const double expected = 440.0 * std::pow(2.0, (n - 69) / 12.0);
+        midiDouble = std::max(midiDouble, std::fabs(midiFrequencyTable<double>[n] - expected) / expected);
+        midiFloat = std::max(midiFloat, std::fabs(midiFrequencyTable<float>[n] - expected) / expected);
+    }
+    checkBelow("midiFrequencyTable<double> error relativo", midiDouble, 1e-14);
+    checkBelow("midiFrequencyTable<float> error relativo", midiFloat, 1e-7);
+
+    return testResult();
+}
@@ -0,0 +1,119 @@
+// Cadena de efectos reordenable: el orden y el bypass se aplican tal cual,
+// y con el hilo de control publicando ordenes nuevos mientras el de audio
+// procesa, cada bloque ve un orden completo de los publicados (nunca uno a
+// medio escribir) y al final el ultimo.
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "synth/effect_chain.h"
+#include "test_check.h"
+
+static const int NUM_EFFECTS = 4;
+static const int BLOCK_FRAMES = 4;
+
+// Efecto que deja su id en el registro del bloque y transforma la senal
+// de forma que el orden cambia el resultado
+struct LoggingEffect : Effect<double> {
+    int id;
+    int* log;
+    int* logCount;
+
+    void process(double* left, double* right, int numSamples) override {
+        if (*logCount < 2 * MAX_EFFECT_SLOTS) log[(*logCount)++] = id;
+        for (int i = 0; i < numSamples; i++) {
+            left[i] = left[i] * 2.0 + id;
+            right[i] = right[i] * 2.0 + id;
+        }
+    }
+
+    bool isIdle() const override { return false; }
+};
+
+struct TestChain {
+    EffectChain<double> chain;
+    LoggingEffect effects[NUM_EFFECTS];
+    int log[2 * MAX_EFFECT_SLOTS];
+    int logCount = 0;
+
+    TestChain() {
+        for (int i = 0; i < NUM_EFFECTS; i++) {
+            effects[i].id = i;
+            effects[i].log = log;
+            effects[i].logCount = &logCount;
+            chain.setSlot(i, &effects[i]);
+        }
+    }
+
+    // Procesa un bloque y devuelve el orden que se uso
+    std::vector<int> run(double* left) {
+        double right[BLOCK_FRAMES] = {};
+        logCount = 0;
+        chain.process(left, right, BLOCK_FRAMES);
+        return std::vector<int>(log, log + logCount);
+    }
+};
+
+// Orden k de los publicados: rotacion k de 0..3 (todas validas y distintas)
+static void rotation(int k, int* ids) {
+    for (int i = 0; i < NUM_EFFECTS; i++) ids[i] = (i + k) % NUM_EFFECTS;
+}
+
+static void checkOrderAndBypass() {
+    TestChain t;
+    const int order[] = {2, 0, 3, 1};
+    t.chain.setOrder(order, NUM_EFFECTS);
+    double left[BLOCK_FRAMES] = {1.0};
+    checkTrue("procesa en el orden pedido", t.run(left) == std::vector<int>({2, 0, 3, 1}));
+    // ((((1 * 2 + 2) * 2 + 0) * 2 + 3) * 2 + 1) = 39
+    checkTrue("la senal pasa en ese orden", left[0] == 39.0);
+
+    t.chain.setBypass(3, true);
+    checkTrue("el bypass saca el slot de la lista", t.run(left) == std::vector<int>({2, 0, 1}));
+    t.chain.setBypass(3, false);
+    checkTrue("sin bypass vuelve a su lugar", t.run(left) == std::vector<int>({2, 0, 3, 1}));
+
+    const int partial[] = {1, 3};
+    t.chain.setOrder(partial, 2);
+    checkTrue("los slots fuera del orden no suenan", t.run(left) == std::vector<int>({1, 3}));
+}
+
+static void checkConcurrentPublish() {
+    TestChain t;
+    const int PUBLISHES = 200000;
+    int first[NUM_EFFECTS];
+    rotation(0, first);
+    t.chain.setOrder(first, NUM_EFFECTS);
+    std::atomic<bool> done(false);
+    std::thread control([&] {
+        int ids[NUM_EFFECTS];
+        for (int p = 0; p < PUBLISHES; p++) {
+            rotation(p % NUM_EFFECTS, ids);
+            t.chain.setOrder(ids, NUM_EFFECTS);
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    long long blocks = 0, torn = 0;
+    double left[BLOCK_FRAMES] = {};
+    while (!done.load(std::memory_order_acquire) || blocks == 0) {
+        const std::vector<int> seen = t.run(left);
+        bool valid = seen.size() == NUM_EFFECTS;
+        for (size_t i = 1; valid && i < seen.size(); i++) valid = seen[i] == (seen[0] + (int)i) % NUM_EFFECTS;
+        if (!valid) torn++;
+        blocks++;
+    }
+    control.join();
+    std::printf("%lld bloques durante %d publicaciones\n", blocks, PUBLISHES);
+    checkTrue("ningun bloque ve un orden a medio publicar", torn == 0);
+
+    int last[NUM_EFFECTS];
+    rotation((PUBLISHES - 1) % NUM_EFFECTS, last);
+    checkTrue("despues queda el ultimo orden publicado",
+              t.run(left) == std::vector<int>(last, last + NUM_EFFECTS));
+}
+
+int main() {
+    checkOrderAndBypass();
+    checkConcurrentPublish();
+    return testResult();
+}
@@ -0,0 +1,112 @@
+// Decay por banda de la FDN de 8 y 16 lineas: un seno grave y uno agudo
+// excitan la red y la pendiente de la cola tiene que dar el RT60 pedido
+// para cada banda. Ademas la salida en float tiene que seguir a la de double.
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "synth/constants.h"
+#include "synth/fdn_reverb.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 256;
+static const double DECAY_LOW = 2.0;
+static const double DECAY_HIGH = 0.5;
+static const double CROSSOVER = 1000.0;
+
+// RT60 de la cola despues de excitar la red con 8 senos entre fromHz y
+// toHz (muchos modos: la cola no bate): regresion del nivel en dB
+// (ventanas de 10 ms) entre -5 y -35 dB del pico, extrapolada a 60 dB
+template <int LINES>
+static double measureDecay(double fromHz, double toHz) {
+    FDNReverbN<Sample, LINES> fdn(TEST_SAMPLE_RATE);
+    fdn.setMix(1.0);
+    fdn.setDecay(DECAY_LOW, DECAY_HIGH, CROSSOVER);
+
+    const int window = (int)(0.01 * TEST_SAMPLE_RATE);
+    const int exciteBlocks = (int)(0.5 * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    const int tailBlocks = (int)(2.5 * DECAY_LOW * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    Sample left[BLOCK_FRAMES], right[BLOCK_FRAMES];
+    std::vector<double> tail;
+    double phase[8] = {};
+    for (int b = 0; b < exciteBlocks + tailBlocks; b++) {
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            double x = 0.0;
+            for (int k = 0; k < 8; k++) {
+                x += std::sin(phase[k]);
+                phase[k] += 2.0 * M_PI * (fromHz + (toHz - fromHz) * k / 7.0) / TEST_SAMPLE_RATE;
+            }
+            left[i] = right[i] = b < exciteBlocks ? (Sample)(0.1 * x) : (Sample)0;
+        }
+        fdn.process(left, right, BLOCK_FRAMES);
+        if (b < exciteBlocks) continue;
+        for (int i = 0; i < BLOCK_FRAMES; i++) tail.push_back((double)left[i] * left[i] + (double)right[i] * right[i]);
+    }
+
+    std::vector<double> level;
+    for (size_t w = 0; w + window <= tail.size(); w += window) {
+        double sum = 0.0;
+        for (int i = 0; i < window; i++) sum += tail[w + i];
+        level.push_back(10.0 * std::log10(sum / window + 1e-30));
+    }
+    const double peak = *std::max_element(level.begin(), level.end());
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t w = 0; w < level.size(); w++) {
+        if (level[w] > peak - 5.0 || level[w] < peak - 35.0) continue;
+        const double t = w * 0.01;
+        n++;
+        sx += t;
+        sy += level[w];
+        sxx += t * t;
+        sxy += t * level[w];
+    }
+    if (n < 2) return 0.0;
+    const double slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);     // dB por segundo
+    return -60.0 / slope;
+}
+
+// Float contra double con la misma entrada: la lectura fraccionaria de las
+// lineas no puede perder resolucion cuando el indice de escritura es alto
+template <typename T>
+static std::vector<double> renderNoise() {
+    FDNReverbN<T, 16> fdn(TEST_SAMPLE_RATE);
+    fdn.setMix(1.0);
+    fdn.setDecay(DECAY_LOW, DECAY_HIGH, CROSSOVER);
+    unsigned int seed = 1;
+    T left[BLOCK_FRAMES], right[BLOCK_FRAMES];
+    std::vector<double> out;
+    for (int b = 0; b < (int)(3.0 * TEST_SAMPLE_RATE / BLOCK_FRAMES); b++) {
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            left[i] = right[i] = (T)(0.2 * ((seed >> 8) / 8388608.0 - 1.0));
+        }
+        fdn.process(left, right, BLOCK_FRAMES);
+        for (int i = 0; i < BLOCK_FRAMES; i++) out.push_back((double)left[i]);
+    }
+    return out;
+}
+
+template <int LINES>
+static double checkDecays(const char* name) {
+    const double low = measureDecay<LINES>(60.0, 200.0);
+    const double high = measureDecay<LINES>(10000.0, 16000.0);
+    std::printf("%s: RT60 graves %.2f s (pedido %.2f), agudos %.2f s (pedido %.2f)\n",
+                name, low, DECAY_LOW, high, DECAY_HIGH);
+    return std::max(std::fabs(low / DECAY_LOW - 1.0), std::fabs(high / DECAY_HIGH - 1.0));
+}
+
+int main() {
+    const std::vector<double> single = renderNoise<float>();
+    const std::vector<double> reference = renderNoise<double>();
+    double maxDiff = 0.0, peak = 0.0;
+    for (size_t i = 0; i < single.size(); i++) {
+        maxDiff = std::max(maxDiff, std::fabs(single[i] - reference[i]));
+        peak = std::max(peak, std::fabs(reference[i]));
+    }
+    checkBelow("FDN 16 float/double, diferencia / pico", maxDiff / peak, 1e-4);
+
+    // El filtro de cruce es de un polo: cada banda se lleva algo de la otra
+    checkBelow("FDN 8 lineas, error relativo del RT60", checkDecays<8>("FDN 8"), 0.15);
+    checkBelow("FDN 16 lineas, error relativo del RT60", checkDecays<16>("FDN 16"), 0.15);
+    return testResult();
+}
@@ -0,0 +1,105 @@
+// Portamento: la altura sigue una recta en semitonos desde la nota
+// anterior y llega a la nueva en el tiempo pedido. En modo Time tarda lo
+// mismo para cualquier salto; en modo Rate tarda lo pedido por octava.
+// La altura se mide con los cruces por cero de un seno puro (indices en 0).
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "synth/engine.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 64;
+static const double LOOKAHEAD_MS = 2.0;     // la salida llega retardada por el limitador
+
+struct PitchPoint {
+    double time;            // segundos desde el noteOn de la segunda nota
+    double semitones;       // nota MIDI medida
+};
+
+// Toca from, despues to con portamento, y mide la altura de to
+static std::vector<PitchPoint> glideTrack(int mode, double ms, int from, int to) {
+    auto engine = std::make_unique<SynthEngine<Sample>>();
+    engine->prepare(TEST_SAMPLE_RATE);
+    engine->setGlide(mode, ms);
+    engine->setLimiter(LOOKAHEAD_MS, -0.3, 50.0);
+    for (int v = 0; v < NUM_VOICES; v++) {
+        FMSynth<Sample>& voice = engine->getVoice(v);
+        voice.setRatio1(1.0); voice.setRatio2(1.0); voice.setRatio3(1.0); voice.setRatio4(1.0);
+        voice.setIndex1(0.0); voice.setIndex2(0.0); voice.setIndex3(0.0); voice.setIndex4(0.0);
+        voice.setAttack(0.001);
+        voice.setRelease(0.001);        // la nota anterior no se mezcla con la medicion
+    }
+
+    std::vector<Sample> buffer(2 * BLOCK_FRAMES);
+    engine->noteOn(from, 0.5);
+    for (int b = 0; b < (int)(0.1 * TEST_SAMPLE_RATE / BLOCK_FRAMES); b++) engine->render(buffer.data(), BLOCK_FRAMES);
+    engine->noteOff(from);
+    engine->noteOn(to, 0.5);
+
+    std::vector<double> signal;
+    for (int b = 0; b < (int)(0.5 * TEST_SAMPLE_RATE / BLOCK_FRAMES); b++) {
+        engine->render(buffer.data(), BLOCK_FRAMES);
+        for (int i = 0; i < BLOCK_FRAMES; i++) signal.push_back(buffer[2 * i]);
+    }
+
+    // Cruces por cero ascendentes interpolados; un periodo entre cada par
+    std::vector<PitchPoint> track;
+    double lastCrossing = -1.0;
+    for (size_t i = 1; i < signal.size(); i++) {
+        if (signal[i - 1] >= 0.0 || signal[i] < 0.0) continue;
+        const double crossing = (i - 1 + signal[i - 1] / (signal[i - 1] - signal[i])) / TEST_SAMPLE_RATE
+                              - LOOKAHEAD_MS * 0.001;
+        if (lastCrossing >= 0.0) {
+            const double freq = 1.0 / (crossing - lastCrossing);
+            track.push_back({0.5 * (crossing + lastCrossing), 69.0 + 12.0 * std::log2(freq / 440.0)});
+        }
+        lastCrossing = crossing;
+    }
+    return track;
+}
+
+static void checkGlide(const char* name, int mode, double ms, int from, int to, double expectedSeconds) {
+    const std::vector<PitchPoint> track = glideTrack(mode, ms, from, to);
+    // Llegada: donde la recta ajustada al tramo central del glide (20% a
+    // 80%) cruza la nota de destino. Un umbral sobre la altura medida
+    // llegaria medio periodo tarde.
+    double maxError = 0.0;
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const PitchPoint& p : track) {
+        if (p.time < 0.01) continue;        // el ataque deforma el primer periodo
+        const double progress = std::min(1.0, p.time / expectedSeconds);
+        maxError = std::max(maxError, std::fabs(p.semitones - (from + (to - from) * progress)));
+        if (progress < 0.2 || progress > 0.8) continue;
+        n++;
+        sx += p.time;
+        sy += p.semitones;
+        sxx += p.time * p.time;
+        sxy += p.time * p.semitones;
+    }
+    const double slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    const double arrival = n < 2 ? -1.0 : (to - (sy - slope * sx) / n) / slope;
+    std::printf("%s: llega en %.1f ms (pedido %.1f ms)\n", name, arrival * 1000.0, expectedSeconds * 1000.0);
+    char label[96];
+    std::snprintf(label, sizeof(label), "%s, error de la recta (semitonos)", name);
+    checkBelow(label, maxError, 0.1);
+    std::snprintf(label, sizeof(label), "%s, error del tiempo de llegada (ms)", name);
+    checkBelow(label, arrival < 0.0 ? 1e9 : std::fabs(arrival - expectedSeconds) * 1000.0, 1.0);
+}
+
+int main() {
+    checkGlide("Time 200 ms, octava arriba", GLIDE_TIME, 200.0, 48, 60, 0.2);
+    checkGlide("Time 200 ms, dos octavas abajo", GLIDE_TIME, 200.0, 72, 48, 0.2);
+    checkGlide("Rate 100 ms, octava arriba", GLIDE_RATE, 100.0, 48, 60, 0.1);
+    checkGlide("Rate 100 ms, dos octavas abajo", GLIDE_RATE, 100.0, 72, 48, 0.2);
+
+    // Sin portamento la nota arranca en su altura
+    const std::vector<PitchPoint> plain = glideTrack(GLIDE_TIME, 0.0, 48, 60);
+    double maxError = 0.0;
+    for (const PitchPoint& p : plain) {
+        if (p.time >= 0.01) maxError = std::max(maxError, std::fabs(p.semitones - 60.0));
+    }
+    checkBelow("sin glide, error de altura (semitonos)", maxError, 0.05);
+    return testResult();
+}
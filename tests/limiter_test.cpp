@@ -0,0 +1,89 @@
+// Limitador del master con un acorde caliente: 8 notas a velocidad maxima
+// suman varias veces el techo. Con cualquier lookahead, con y sin
+// saturacion, ningun sample de la salida del motor puede pasar el techo.
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "synth/engine.h"
+#include "synth/note_table.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 256;
+static const double CEILING_DB = -1.0;
+
+static const int CHORD[] = {36, 43, 48, 52, 55, 60, 64, 67};
+static const int CHORD_SIZE = 8;
+
+static void setupVoice(FMSynth<Sample>& voice) {
+    voice.setAttack(0.001);
+    voice.setIndex2(3.0);
+    voice.setRelease(0.1);
+}
+
+// Pico del acorde antes del master: las voces sumadas a mano (en el centro
+// la ganancia del paneo es 1)
+static double chordInputPeak() {
+    const NoteTable table;
+    std::unique_ptr<FMSynth<Sample>> voices[CHORD_SIZE];
+    for (int v = 0; v < CHORD_SIZE; v++) {
+        voices[v] = std::make_unique<FMSynth<Sample>>(440.0, TEST_SAMPLE_RATE);
+        setupVoice(*voices[v]);
+        voices[v]->noteOn(table[CHORD[v]], table.velocity(1.0));
+    }
+    Sample voiceBuffer[BLOCK_FRAMES];
+    double mono[BLOCK_FRAMES];
+    double peak = 0.0;
+    for (int b = 0; b < (int)(0.7 * TEST_SAMPLE_RATE / BLOCK_FRAMES); b++) {
+        std::fill(mono, mono + BLOCK_FRAMES, 0.0);
+        for (int v = 0; v < CHORD_SIZE; v++) {
+            voices[v]->render(voiceBuffer, BLOCK_FRAMES);
+            for (int i = 0; i < BLOCK_FRAMES; i++) mono[i] += voiceBuffer[i];
+        }
+        for (int i = 0; i < BLOCK_FRAMES; i++) peak = std::max(peak, std::fabs(mono[i]));
+    }
+    return peak;
+}
+
+static double renderChord(double lookaheadMs, bool saturate, double ceilingDb) {
+    auto engine = std::make_unique<SynthEngine<Sample>>();
+    engine->prepare(TEST_SAMPLE_RATE);
+    engine->setLimiter(lookaheadMs, ceilingDb, 50.0);
+    engine->setSaturationEnabled(saturate);
+    engine->setSaturation(SAT_CUBIC, 3.0, true);
+    for (int v = 0; v < NUM_VOICES; v++) setupVoice(engine->getVoice(v));
+
+    for (int note : CHORD) engine->noteOn(note, 1.0);
+    std::vector<Sample> buffer(2 * BLOCK_FRAMES);
+    double peak = 0.0;
+    for (int b = 0; b < (int)(1.0 * TEST_SAMPLE_RATE / BLOCK_FRAMES); b++) {
+        if (b == (int)(0.7 * TEST_SAMPLE_RATE / BLOCK_FRAMES)) {
+            for (int note : CHORD) engine->noteOff(note);
+        }
+        engine->render(buffer.data(), BLOCK_FRAMES);
+        for (Sample s : buffer) peak = std::max(peak, (double)std::fabs(s));
+    }
+    return peak;
+}
+
+int main() {
+    const double ceiling = dbToGain(CEILING_DB);
+    const double hot = chordInputPeak() / ceiling;
+    std::printf("pico del acorde antes del limitador: %.2f veces el techo\n", hot);
+    checkTrue("el acorde pasa el techo", hot > 1.5);
+
+    const double lookaheads[] = {1.0, 2.0, 5.0};
+    for (double ms : lookaheads) {
+        for (int saturate = 0; saturate < 2; saturate++) {
+            const double peak = renderChord(ms, saturate != 0, CEILING_DB);
+            char label[64];
+            std::snprintf(label, sizeof(label), "lookahead %.0f ms%s, pico / techo", ms, saturate ? " saturado" : "");
+            // Tolerancia de redondeo del tipo de sample
+            checkBelow(label, peak / ceiling, 1.0 + 1e-6);
+            std::snprintf(label, sizeof(label), "lookahead %.0f ms%s, dB bajo el techo", ms, saturate ? " saturado" : "");
+            checkBelow(label, 20.0 * std::log10(ceiling / peak), 1.0);
+        }
+    }
+    return testResult();
+}
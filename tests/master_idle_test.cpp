@@ -0,0 +1,115 @@
+// El motor en silencio: cuando las voces y la cadena de efectos quedan
+// inactivas el master (saturacion con oversampling, DC blocker y limitador
+// con lookahead) tiene que sacar lo que le quedaba en la latencia y quedar
+// en cero, igual que las reverbs (incluida la de convolucion).
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "synth/engine.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 64;         // menos que el lookahead: el vaciado lleva varios bloques
+static const char* IR_PATH = "master_idle_test_ir.wav";
+
+// IR mono de 0.2 s (ruido que decae) como WAV PCM 16 bits
+static bool writeImpulseResponse(const char* path) {
+    const int length = (int)(0.2 * TEST_SAMPLE_RATE);
+    std::vector<int16_t> pcm(length);
+    unsigned int seed = 1;
+    for (int i = 0; i < length; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(20000.0 * ((seed >> 8) / 8388608.0 - 1.0) * std::exp(-i / 2000.0));
+    }
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    auto write32 = [f](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto write16 = [f](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    write32(36 + 2 * length);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    write32(16);
+    write16(1);                             // PCM
+    write16(1);
+    write32((uint32_t)TEST_SAMPLE_RATE);
+    write32((uint32_t)TEST_SAMPLE_RATE * 2);
+    write16(2);
+    write16(16);
+    std::fwrite("data", 1, 4, f);
+    write32(2 * length);
+    std::fwrite(pcm.data(), 2, length, f);
+    std::fclose(f);
+    return true;
+}
+
+struct IdleResult {
+    double drainPeak = 0.0;     // salida despues de que la ultima voz termina
+    bool silentAfter = true;    // ceros exactos despues del vaciado
+    bool stateZero = false;
+};
+
+static IdleResult runChord(int reverbType, double reverbMix) {
+    auto engine = std::make_unique<SynthEngine<Sample>>();
+    engine->prepare(TEST_SAMPLE_RATE);
+    if (reverbType == REVERB_CONVOLUTION) engine->loadImpulseResponse(IR_PATH);
+    engine->setReverbType(reverbType);
+    engine->setReverbMix(reverbMix);
+    engine->setSaturationEnabled(true);
+    engine->setSaturation(SAT_TANH, 2.0, true);
+    engine->setLimiter(5.0, -1.0, 50.0);
+    for (int v = 0; v < NUM_VOICES; v++) {
+        engine->getVoice(v).setAttack(0.001);
+        engine->getVoice(v).setRelease(0.005);
+    }
+
+    const int notes[] = {48, 55, 60, 64};
+    for (int note : notes) engine->noteOn(note, 1.0);
+    std::vector<Sample> buffer(2 * BLOCK_FRAMES);
+    const int chordBlocks = (int)(0.2 * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    for (int b = 0; b < chordBlocks; b++) engine->render(buffer.data(), BLOCK_FRAMES);
+    for (int note : notes) engine->noteOff(note);
+
+    // Silencio largo: la cola de la reverb cae bajo el umbral y se limpia
+    IdleResult r;
+    bool voicesDone = false;
+    const int silenceBlocks = (int)(6.0 * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    const int lastBlocks = (int)(0.5 * TEST_SAMPLE_RATE / BLOCK_FRAMES);
+    for (int b = 0; b < silenceBlocks; b++) {
+        engine->render(buffer.data(), BLOCK_FRAMES);
+        for (Sample s : buffer) {
+            if (voicesDone) r.drainPeak = std::max(r.drainPeak, (double)std::fabs(s));
+            if (b >= silenceBlocks - lastBlocks && s != 0) r.silentAfter = false;
+        }
+        if (!voicesDone) {
+            voicesDone = true;
+            for (int v = 0; v < NUM_VOICES; v++) voicesDone = voicesDone && !engine->isVoiceActive(v);
+        }
+    }
+    r.stateZero = engine->isTailStateZero();
+    return r;
+}
+
+int main() {
+    checkTrue("escribe la IR de prueba", writeImpulseResponse(IR_PATH));
+
+    // Sin reverb la cadena queda inactiva con la ultima voz: lo que esta
+    // en el lookahead y en el oversampling sale en los bloques siguientes
+    IdleResult dry = runChord(REVERB_SCHROEDER, 0.0);
+    checkTrue("sin reverb: el master vacia su latencia", dry.drainPeak > 0.0);
+    checkTrue("sin reverb: despues sale en cero exacto", dry.silentAfter);
+    checkTrue("sin reverb: master y envolventes en cero", dry.stateZero);
+
+    const int types[] = {REVERB_SCHROEDER, REVERB_FDN, REVERB_CONVOLUTION};
+    const char* names[] = {"Schroeder", "FDN", "convolucion"};
+    for (int t = 0; t < 3; t++) {
+        IdleResult wet = runChord(types[t], 0.4);
+        char label[96];
+        std::snprintf(label, sizeof(label), "%s: despues sale en cero exacto", names[t]);
+        checkTrue(label, wet.silentAfter);
+        std::snprintf(label, sizeof(label), "%s: reverb, master y envolventes en cero", names[t]);
+        checkTrue(label, wet.stateZero);
+    }
+    std::remove(IR_PATH);
+    return testResult();
+}
@@ -0,0 +1,89 @@
+// Matriz de modulacion rala: con rutas en slots salteados (dos al mismo
+// destino, una con amount cero, una con destino invalido) los offsets de
+// cada columna tienen que ser los del producto denso fuente x amount x
+// medio rango del destino. Borrar rutas las saca de la lista compilada.
+#include <cmath>
+#include <cstdio>
+#include "synth/mod_matrix.h"
+#include "test_check.h"
+
+struct TestRoute {
+    int slot;
+    int source;
+    int destination;
+    double amount;
+};
+
+static double sources[MOD_SRC_COUNT][MOD_COLUMNS];
+static double offsets[MOD_DST_COUNT][MOD_COLUMNS];
+
+// Offsets esperados con la matriz densa [destino][fuente]
+static double denseError(const TestRoute* routes, int count, int numColumns) {
+    double dense[MOD_DST_COUNT][MOD_SRC_COUNT] = {};
+    for (int r = 0; r < count; r++) {
+        const TestRoute& t = routes[r];
+        if (t.destination < 0 || t.destination >= MOD_DST_COUNT) continue;
+        dense[t.destination][t.source] += t.amount * (modDestinationMax[t.destination] - modDestinationMin[t.destination]) * 0.5;
+    }
+    double error = 0.0;
+    for (int d = 0; d < MOD_DST_COUNT; d++) {
+        for (int v = 0; v < numColumns; v++) {
+            double expected = 0.0;
+            for (int s = 0; s < MOD_SRC_COUNT; s++) expected += dense[d][s] * sources[s][v];
+            error = std::max(error, std::fabs(offsets[d][v] - expected));
+        }
+    }
+    return error;
+}
+
+int main() {
+    unsigned int seed = 1;
+    for (int s = 0; s < MOD_SRC_COUNT; s++) {
+        for (int v = 0; v < MOD_COLUMNS; v++) {
+            seed = seed * 1664525u + 1013904223u;
+            sources[s][v] = (seed >> 8) / 8388608.0 - 1.0;
+        }
+    }
+
+    ModMatrix matrix;
+    checkTrue("sin rutas devuelve false", !matrix.process(sources, offsets, MOD_COLUMNS));
+    checkBelow("sin rutas, offsets", denseError(nullptr, 0, MOD_COLUMNS), 1e-15);
+
+    const TestRoute routes[] = {
+        {0, MOD_SRC_LFO1, MOD_DST_PITCH, 0.1},
+        {3, MOD_SRC_VELOCITY, MOD_DST_INDEX2, 0.8},
+        {7, MOD_SRC_KEY, MOD_DST_INDEX2, -0.5},             // mismo destino: se suman
+        {9, MOD_SRC_MOD_WHEEL, MOD_DST_FILTER_CUT, 0.0},    // amount cero: no entra
+        {12, MOD_SRC_AFTERTOUCH, MOD_DST_COUNT, 1.0},       // destino invalido: slot libre
+        {15, MOD_SRC_SLIDE, MOD_DST_REVERB, 0.3},
+    };
+    const int count = sizeof(routes) / sizeof(routes[0]);
+    for (const TestRoute& r : routes) matrix.setRoute(r.slot, r.source, r.destination, r.amount);
+
+    checkTrue("con rutas devuelve true", matrix.process(sources, offsets, MOD_COLUMNS));
+    checkBelow("rutas salteadas contra la matriz densa", denseError(routes, count, MOD_COLUMNS), 1e-12);
+
+    // Menos columnas (voces activas + master): solo se escriben esas
+    for (int d = 0; d < MOD_DST_COUNT; d++) offsets[d][MOD_COLUMNS - 1] = 123.0;
+    matrix.process(sources, offsets, 5);
+    bool untouched = true;
+    for (int d = 0; d < MOD_DST_COUNT; d++) untouched = untouched && offsets[d][MOD_COLUMNS - 1] == 123.0;
+    checkBelow("5 columnas contra la matriz densa", denseError(routes, count, 5), 1e-12);
+    checkTrue("las columnas de mas no se tocan", untouched);
+
+    // Borrar dos rutas y cambiar el amount de otra
+    matrix.clearRoute(3);
+    matrix.setRoute(15, MOD_SRC_SLIDE, -1, 0.3);
+    matrix.setRoute(7, MOD_SRC_KEY, MOD_DST_INDEX2, 1.0);
+    const TestRoute remaining[] = {
+        {0, MOD_SRC_LFO1, MOD_DST_PITCH, 0.1},
+        {7, MOD_SRC_KEY, MOD_DST_INDEX2, 1.0},
+    };
+    matrix.process(sources, offsets, MOD_COLUMNS);
+    checkBelow("despues de borrar y editar", denseError(remaining, 2, MOD_COLUMNS), 1e-12);
+
+    matrix.clearRoute(0);
+    matrix.clearRoute(7);
+    checkTrue("todas borradas devuelve false", !matrix.process(sources, offsets, MOD_COLUMNS));
+    return testResult();
+}
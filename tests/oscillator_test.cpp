@@ -0,0 +1,178 @@
+// Operador libre: processFree (fasores) y skip (fase en forma cerrada) tienen
+// que dar lo mismo que N llamadas a process(), con rampas que terminan antes,
+// justo en o despues del final del tramo, tramos que no son multiplo de 4,
+// mas de 32 tramos seguidos (resiembra) y mezclados con process() y skip().
+#include <cmath>
+#include <cstdio>
+#include "synth/constants.h"
+#include "synth/oscillator.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+// Diferencia permitida: la del seno por tabla de process() (< 3e-7) mas el
+// redondeo de la fase a Sample
+static const double MAX_ERROR = 2e-6;
+
+// El mismo oscilador dos veces: fast por el camino rapido, ref sample a sample
+struct OscPair {
+    Oscillator<Sample> fast;
+    Oscillator<Sample> ref;
+    double maxError = 0.0;
+
+    explicit OscPair(double freq) : fast(freq, TEST_SAMPLE_RATE), ref(freq, TEST_SAMPLE_RATE) {}
+
+    void ramp(double freq, int numSamples) {
+        fast.rampFrequency(freq, numSamples);
+        ref.rampFrequency(freq, numSamples);
+    }
+
+    void set(double freq) {
+        fast.setFrequency(freq);
+        ref.setFrequency(freq);
+    }
+
+    void free(int numSamples) {
+        Sample out[MAX_BLOCK_SIZE];
+        fast.processFree(out, numSamples);
+        for (int i = 0; i < numSamples; i++) compare(out[i], ref.process());
+    }
+
+    void skip(int numSamples) {
+        fast.skip(numSamples);
+        for (int i = 0; i < numSamples; i++) ref.process();
+    }
+
+    void one() { compare(fast.process(), ref.process()); }
+
+    void compare(Sample a, Sample b) { maxError = std::max(maxError, (double)std::fabs(a - b)); }
+};
+
+static void checkOddLengths() {
+    OscPair p(440.0);
+    const int lengths[] = {1, 2, 3, 5, 7, 13, 31, 63, 129, 511};
+    for (int r = 0; r < 100; r++) {
+        for (int n : lengths) p.free(n);
+    }
+    checkBelow("tramos de 1 a 511 samples, sin rampa", p.maxError, MAX_ERROR);
+
+    OscPair q(440.0);
+    for (int r = 0; r < 200; r++) {
+        for (int n : lengths) {
+            q.ramp(440.0 * (1.0 + 0.02 * std::sin(r * 0.37 + n)), n);
+            q.free(n);
+        }
+    }
+    checkBelow("tramos de 1 a 511 samples, con rampa", q.maxError, MAX_ERROR);
+}
+
+static void checkManySegments() {
+    // 4000 tramos fijos: la fase en fasores se resiembra cada 32
+    OscPair fixed(3520.0);
+    for (int s = 0; s < 4000; s++) fixed.free(CONTROL_BLOCK_SIZE);
+    checkBelow("4000 tramos sin rampa (resiembra)", fixed.maxError, MAX_ERROR);
+
+    // Vibrato: la rampa cambia en cada tramo y se corrige R sin resembrar
+    OscPair vibrato(440.0);
+    for (int s = 0; s < 4000; s++) {
+        vibrato.ramp(440.0 * std::pow(2.0, 0.5 / 12.0 * std::sin(s * 0.05)), CONTROL_BLOCK_SIZE);
+        vibrato.free(CONTROL_BLOCK_SIZE);
+    }
+    checkBelow("4000 tramos con vibrato (retune)", vibrato.maxError, MAX_ERROR);
+
+    // Saltos grandes de rampa en cada tramo: retune los rechaza y se siembra
+    OscPair jumps(100.0);
+    for (int s = 0; s < 500; s++) {
+        jumps.ramp(s % 2 ? 100.0 : 8000.0, CONTROL_BLOCK_SIZE);
+        jumps.free(CONTROL_BLOCK_SIZE);
+    }
+    checkBelow("500 tramos con saltos de 100 Hz a 8 kHz", jumps.maxError, MAX_ERROR);
+}
+
+static void checkRampBoundaries() {
+    OscPair p(440.0);
+    p.free(64);
+    p.ramp(880.0, 10);          // termina dentro del tramo
+    p.free(64);
+    p.ramp(220.0, 64);          // termina justo al final
+    p.free(64);
+    p.ramp(660.0, 200);         // sigue en los tramos siguientes y termina en el cuarto
+    for (int s = 0; s < 4; s++) p.free(64);
+    p.ramp(1000.0, 1);          // un solo sample
+    p.free(5);
+    p.ramp(5000.0, 3);          // menos que una vuelta de las 4 lanes
+    p.free(3);
+    p.free(61);
+    p.ramp(900.0, 100);         // setFrequency corta la rampa a la mitad
+    p.free(30);
+    p.set(300.0);
+    p.free(64);
+    p.ramp(700.0, 64);          // rampa con un tramo mas largo
+    p.free(257);
+    checkBelow("rampas que terminan antes, en y despues del tramo", p.maxError, MAX_ERROR);
+}
+
+static void checkSkip() {
+    OscPair p(440.0);
+    for (int r = 0; r < 50; r++) {
+        p.free(37);
+        p.skip(45);             // despues de processFree
+        p.free(19);
+        p.one();
+        p.skip(3);              // despues de process()
+        p.one();
+        p.ramp(440.0 + 10.0 * r, 100);
+        p.skip(30);             // dentro de la rampa
+        p.skip(90);             // cruza el final de la rampa
+        p.free(64);
+        p.ramp(440.0, 50);
+        p.free(21);
+        p.skip(29);             // termina justo con la rampa
+        p.free(64);
+    }
+    checkBelow("skip contra la fase que deja process()", p.maxError, MAX_ERROR);
+}
+
+// Mezcla al azar de todo lo anterior
+static void checkRandomMix() {
+    OscPair p(440.0);
+    unsigned int seed = 12345;
+    auto next = [&seed](int range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (int)((seed >> 8) % (unsigned int)range);
+    };
+    for (int op = 0; op < 20000; op++) {
+        const int n = 1 + next(MAX_BLOCK_SIZE);
+        switch (next(6)) {
+            case 0: p.ramp(50.0 + next(8000), 1 + next(300)); break;
+            case 1: p.set(50.0 + next(8000)); break;
+            case 2: p.skip(n); break;
+            case 3: p.one(); break;
+            default: p.free(n); break;
+        }
+    }
+    checkBelow("20000 operaciones al azar", p.maxError, MAX_ERROR);
+}
+
+// Con tabla de onda processFree lee sample a sample; skip sigue en forma
+// cerrada, asi que la fase puede diferir en el redondeo
+static void checkWavetable() {
+    OscPair p(440.0);
+    p.fast.setWavetable(builtinWavetable<Sample>(WAVE_W2));
+    p.ref.setWavetable(builtinWavetable<Sample>(WAVE_W2));
+    for (int s = 0; s < 100; s++) {
+        p.ramp(440.0 + s, 50);
+        p.free(37);
+        p.skip(13);
+    }
+    checkBelow("con tabla de onda, processFree y skip", p.maxError, MAX_ERROR);
+}
+
+int main() {
+    checkOddLengths();
+    checkManySegments();
+    checkRampBoundaries();
+    checkSkip();
+    checkRandomMix();
+    checkWavetable();
+    return testResult();
+}
@@ -0,0 +1,96 @@
+// Paneo de las voces: con potencia constante normalizada la relacion R/L
+// de una nota sola es tan((pan + 1) pi / 4) y L^2 + R^2 no cambia con el
+// paneo. El spread por altura manda los graves a la izquierda y los agudos
+// a la derecha; el aleatorio reparte las notas por todo el campo.
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "synth/engine.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 256;
+
+struct Balance {
+    double left = 0.0;      // energia de cada canal
+    double right = 0.0;
+};
+
+// Una nota (velocity baja: el limitador no entra) y su energia por canal
+static Balance renderNote(SynthEngine<Sample>& engine, int note) {
+    engine.noteOn(note, 0.3);
+    std::vector<Sample> buffer(2 * BLOCK_FRAMES);
+    Balance b;
+    for (int k = 0; k < (int)(0.3 * TEST_SAMPLE_RATE / BLOCK_FRAMES); k++) {
+        engine.render(buffer.data(), BLOCK_FRAMES);
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            b.left += (double)buffer[2 * i] * buffer[2 * i];
+            b.right += (double)buffer[2 * i + 1] * buffer[2 * i + 1];
+        }
+    }
+    engine.noteOff(note);
+    for (int k = 0; k < (int)(0.5 * TEST_SAMPLE_RATE / BLOCK_FRAMES); k++) engine.render(buffer.data(), BLOCK_FRAMES);
+    return b;
+}
+
+static std::unique_ptr<SynthEngine<Sample>> makeEngine() {
+    auto engine = std::make_unique<SynthEngine<Sample>>();
+    engine->prepare(TEST_SAMPLE_RATE);
+    for (int v = 0; v < NUM_VOICES; v++) {
+        engine->getVoice(v).setAttack(0.001);
+        engine->getVoice(v).setRelease(0.01);
+    }
+    return engine;
+}
+
+static void checkPanLaw() {
+    auto engine = makeEngine();
+    const Balance center = renderNote(*engine, 60);
+    checkBelow("centro, |R/L - 1|", std::fabs(std::sqrt(center.right / center.left) - 1.0), 1e-3);
+
+    const double pans[] = {-0.75, -0.3, 0.3, 0.75};
+    double ratioError = 0.0, powerError = 0.0;
+    for (double pan : pans) {
+        engine->setPan(pan);
+        const Balance b = renderNote(*engine, 60);
+        const double expected = std::tan((pan + 1.0) * 0.25 * M_PI);
+        ratioError = std::max(ratioError, std::fabs(std::sqrt(b.right / b.left) / expected - 1.0));
+        powerError = std::max(powerError, std::fabs((b.left + b.right) / (center.left + center.right) - 1.0));
+        std::printf("pan %+.2f: R/L %.4f (esperado %.4f)\n", pan, std::sqrt(b.right / b.left), expected);
+    }
+    checkBelow("R/L contra tan((pan + 1) pi / 4), error", ratioError, 1e-3);
+    checkBelow("L^2 + R^2 contra el centro, error", powerError, 1e-3);
+
+    engine->setPan(-1.0);
+    const Balance hardLeft = renderNote(*engine, 60);
+    checkBelow("pan -1, energia R / L", hardLeft.right / hardLeft.left, 1e-12);
+}
+
+static void checkSpread() {
+    auto engine = makeEngine();
+    engine->setSpread(1.0, SPREAD_KEY);
+    const Balance low = renderNote(*engine, 36);         // dos octavas abajo: todo a la izquierda
+    const Balance mid = renderNote(*engine, 60);
+    const Balance high = renderNote(*engine, 84);
+    checkBelow("spread por altura, grave: R / L", low.right / low.left, 1e-12);
+    checkBelow("spread por altura, centro: |R/L - 1|", std::fabs(std::sqrt(mid.right / mid.left) - 1.0), 1e-3);
+    checkBelow("spread por altura, agudo: L / R", high.left / high.right, 1e-12);
+
+    // Aleatorio: la misma nota cae en lugares distintos, a los dos lados
+    engine->setSpread(1.0, SPREAD_RANDOM);
+    int leftNotes = 0, rightNotes = 0;
+    for (int n = 0; n < 16; n++) {
+        const Balance b = renderNote(*engine, 60);
+        if (b.left > 1.1 * b.right) leftNotes++;
+        if (b.right > 1.1 * b.left) rightNotes++;
+    }
+    std::printf("spread aleatorio: %d notas a la izquierda, %d a la derecha de 16\n", leftNotes, rightNotes);
+    checkTrue("spread aleatorio a los dos lados", leftNotes >= 3 && rightNotes >= 3);
+}
+
+int main() {
+    checkPanLaw();
+    checkSpread();
+    return testResult();
+}
@@ -0,0 +1,98 @@
+// La version float del motor contra la de referencia en double: la misma
+// secuencia de notas y el mismo patch por los dos, comparando la salida
+// sample a sample. La reverb por convolucion queda afuera: su cola depende
+// de cuando termina el hilo de fondo y no es determinista fuera de tiempo real.
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "synth/engine.h"
+#include "test_check.h"
+
+static const double SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 256;
+static const int NUM_BLOCKS = 600;              // ~3.2 s
+
+// Tolerancias absolutas sobre una salida de escala completa (pico menor que 1)
+static const double MAX_DIFF_LIMIT = 2e-4;
+static const double RMS_DIFF_LIMIT = 2e-5;
+
+template <typename T>
+static void setupPatch(SynthEngine<T>& engine, int reverbType) {
+    engine.prepare(SAMPLE_RATE);
+    engine.setReverbType(reverbType);
+    engine.setReverbMix(0.3);
+    engine.setChorusMix(0.4);
+    engine.setFilter(FILTER_LOWPASS, 2500.0, 0.9);
+    engine.setLfo(0, 5.0, 0.2, LFO_INDEX2, LFO_SINE);
+    for (int v = 0; v < NUM_VOICES; v++) {
+        FMSynth<T>& voice = engine.getVoice(v);
+        voice.setAlgorithm(v % ALG_COUNT);
+        voice.setIndex1(0.3);
+        voice.setIndex2(2.0);
+        voice.setIndex3(1.0);
+        voice.setIndex4(0.5);
+        voice.setRelease(0.4);
+    }
+}
+
+// Eventos en el bloque indicado: nota > 0 es noteOn, < 0 es noteOff
+struct NoteEvent {
+    int block;
+    int note;
+    double velocity;
+};
+
+static const NoteEvent events[] = {
+    {0, 48, 1.0}, {0, 60, 0.8}, {40, 64, 0.6}, {80, 67, 0.9}, {120, -60, 0},
+    {160, 72, 0.5}, {200, -48, 0}, {200, -64, 0}, {260, 55, 1.0}, {300, -67, 0},
+    {300, -72, 0}, {380, -55, 0},
+};
+
+template <typename T>
+static std::vector<double> renderSequence(int reverbType) {
+    auto engine = std::make_unique<SynthEngine<T>>();
+    setupPatch(*engine, reverbType);
+    std::vector<T> buffer(2 * BLOCK_FRAMES);
+    std::vector<double> out;
+    out.reserve((size_t)NUM_BLOCKS * 2 * BLOCK_FRAMES);
+    for (int b = 0; b < NUM_BLOCKS; b++) {
+        for (const NoteEvent& e : events) {
+            if (e.block != b) continue;
+            if (e.note > 0) {
+                engine->noteOn(e.note, e.velocity);
+            } else {
+                engine->noteOff(-e.note);
+            }
+        }
+        engine->render(buffer.data(), BLOCK_FRAMES);
+        for (T s : buffer) out.push_back((double)s);
+    }
+    return out;
+}
+
+int main() {
+    const int reverbTypes[] = {REVERB_SCHROEDER, REVERB_FDN};
+    const char* names[] = {"Schroeder", "FDN"};
+    for (int r = 0; r < 2; r++) {
+        std::vector<double> single = renderSequence<float>(reverbTypes[r]);
+        std::vector<double> reference = renderSequence<double>(reverbTypes[r]);
+
+        double maxDiff = 0.0, sumSquares = 0.0, peak = 0.0;
+        bool finite = true;
+        for (size_t i = 0; i < reference.size(); i++) {
+            const double diff = std::fabs(single[i] - reference[i]);
+            finite = finite && std::isfinite(single[i]) && std::isfinite(reference[i]);
+            maxDiff = std::max(maxDiff, diff);
+            sumSquares += diff * diff;
+            peak = std::max(peak, std::fabs(reference[i]));
+        }
+        const double rmsDiff = std::sqrt(sumSquares / reference.size());
+
+        std::printf("%s: pico %.3f\n", names[r], peak);
+        checkTrue("salida finita", finite);
+        checkTrue("la secuencia suena", peak > 0.1);
+        checkBelow("diferencia maxima float/double", maxDiff, MAX_DIFF_LIMIT);
+        checkBelow("diferencia RMS float/double", rmsDiff, RMS_DIFF_LIMIT);
+    }
+    return testResult();
+}
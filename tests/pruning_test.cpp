@@ -0,0 +1,113 @@
+// Poda de operadores: en cada algoritmo, con cada combinacion de indices en
+// cero y distintos de cero, la voz con poda tiene que sonar igual que la que
+// evalua los cuatro operadores, y un operador que vuelve despues de estar
+// podado tiene que seguir con la fase que habria tenido sin poda.
+#include <cmath>
+#include <cstdio>
+#include "synth/constants.h"
+#include "synth/fm_synth.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int SEGMENTS = 200;
+// Relativo al pico: lo que separa a skip() de sumar la fase sample a sample
+static const double MAX_ERROR = 1e-5;
+
+static const double RATIOS[4] = {1.0, 2.01, 3.5, 0.51};
+static const double INDICES[4] = {0.4, 2.0, 1.5, 1.0};
+
+// La misma nota por dos voces: pruned con poda, full sin poda
+struct VoicePair {
+    FMSynth<Sample> pruned;
+    FMSynth<Sample> full;
+    double maxDiff = 0.0;
+    double peak = 0.0;
+
+    explicit VoicePair(int alg) : pruned(220.0, TEST_SAMPLE_RATE), full(220.0, TEST_SAMPLE_RATE) {
+        full.setPruning(false);
+        FMSynth<Sample>* voices[] = {&pruned, &full};
+        for (FMSynth<Sample>* v : voices) {
+            v->setAlgorithm(alg);
+            v->setAttack(0.001);
+            v->setSustain(1.0);
+            v->noteOn({220.0, 1.0, 1.0, 1.0}, 1.0);
+        }
+    }
+
+    // Un tramo con los indices de mask (bit k = indice k distinto de cero)
+    void segment(int mask) {
+        VoiceControl c;
+        for (int k = 0; k < 4; k++) {
+            c.ratio[k] = RATIOS[k];
+            c.index[k] = (mask & (1 << k)) ? INDICES[k] : 0.0;
+        }
+        c.pitch = 1.0;
+        Sample a[CONTROL_BLOCK_SIZE], b[CONTROL_BLOCK_SIZE];
+        pruned.render(a, CONTROL_BLOCK_SIZE, c);
+        full.render(b, CONTROL_BLOCK_SIZE, c);
+        for (int i = 0; i < CONTROL_BLOCK_SIZE; i++) {
+            maxDiff = std::max(maxDiff, (double)std::fabs(a[i] - b[i]));
+            peak = std::max(peak, (double)std::fabs(b[i]));
+        }
+    }
+
+    double error() const { return peak > 0.0 ? maxDiff / peak : 1.0; }
+};
+
+// Indices fijos: las 16 combinaciones de cero y distinto de cero
+static void checkStaticIndices(int alg) {
+    double worst = 0.0;
+    bool zeroNeverLive = true, allLive = true;
+    int prunedSegments = 0;
+    for (int mask = 0; mask < 16; mask++) {
+        VoicePair p(alg);
+        for (int s = 0; s < SEGMENTS; s++) {
+            p.segment(mask);
+            const int live = p.pruned.getLiveOperators();
+            if (live != 0xF) prunedSegments++;
+            // El primer tramo baja los indices del patch: todavia aportan. Los
+            // carriers suenan siempre (su indice no es su nivel)
+            if (s > 0 && (live & ~mask & ~carrierOperators(alg))) zeroNeverLive = false;
+            if (mask == 0xF && live != 0xF) allLive = false;
+        }
+        worst = std::max(worst, p.error());
+    }
+    char label[96];
+    std::snprintf(label, sizeof(label), "%s: indices fijos, con poda contra sin poda", algorithmNames[alg]);
+    checkBelow(label, worst, MAX_ERROR);
+    std::snprintf(label, sizeof(label), "%s: un modulador con indice cero se poda", algorithmNames[alg]);
+    checkTrue(label, zeroNeverLive && prunedSegments > 0);
+    std::snprintf(label, sizeof(label), "%s: con todos los indices no se poda nada", algorithmNames[alg]);
+    checkTrue(label, allLive);
+}
+
+// Cada modulador se apaga 40 tramos y vuelve: la fase sigue como sin poda
+static void checkReturn(int alg) {
+    double worst = 0.0;
+    bool prunedWhileOff = true, liveAfter = true;
+    for (int k = 1; k < 4; k++) {
+        if (carrierOperators(alg) & (1 << k)) continue;
+        VoicePair p(alg);
+        const int off = 0xF & ~(1 << k);
+        for (int s = 0; s < 100; s++) {
+            p.segment(s >= 20 && s < 60 ? off : 0xF);
+            const bool live = p.pruned.getLiveOperators() & (1 << k);
+            if (s > 20 && s < 60 && live) prunedWhileOff = false;
+            if (s >= 60 && !live) liveAfter = false;
+        }
+        worst = std::max(worst, p.error());
+    }
+    char label[96];
+    std::snprintf(label, sizeof(label), "%s: operador que vuelve despues de podado", algorithmNames[alg]);
+    checkBelow(label, worst, MAX_ERROR);
+    std::snprintf(label, sizeof(label), "%s: se poda mientras esta apagado y vuelve", algorithmNames[alg]);
+    checkTrue(label, prunedWhileOff && liveAfter);
+}
+
+int main() {
+    for (int alg = 0; alg < ALG_COUNT; alg++) {
+        checkStaticIndices(alg);
+        checkReturn(alg);
+    }
+    return testResult();
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdio>
+
+// Chequeos minimos para los tests (sin framework): cada uno imprime el valor
+// medido contra su limite y cuenta las fallas. main() devuelve testResult().
+inline int testFailures = 0;
+
+inline void checkBelow(const char* what, double value, double limit) {
+    bool ok = value < limit;
+    std::printf("%s %-44s %.3g (limite %.3g)\n", ok ? "ok  " : "FAIL", what, value, limit);
+    if (!ok) testFailures++;
+}
+
+inline void checkTrue(const char* what, bool ok) {
+    std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) testFailures++;
+}
+
+inline int testResult() { return testFailures == 0 ? 0 : 1; }
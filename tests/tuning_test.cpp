@@ -0,0 +1,173 @@
+// Parser Scala: comentarios en cualquier lugar, grados en razones y en
+// cents, teclas "x" sin nota en el .kbm, y archivos cortos o con lineas
+// invalidas rechazados sin tocar la afinacion anterior.
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "synth/tuning.h"
+#include "test_check.h"
+
+// Escala justa de 7 notas con comentarios, texto despues de los grados y
+// sin salto de linea al final
+static const char* JUST_SCALE =
+    "! just.scl\n"
+    "!\n"
+    "Just major, with comments\n"
+    " 7\n"
+    "!\n"
+    " 9/8\n"
+    " 5/4   tercera mayor\n"
+    " 4/3\n"
+    "! comentario entre grados\n"
+    " 3/2\n"
+    " 884.35871\n"
+    " 15/8\n"
+    " 2/1";
+
+// 12 teclas por patron sobre la escala de 7: las negras no suenan
+static const char* WHITE_KEYS_MAP =
+    "! white.kbm\n"
+    "12\n"
+    "0\n"
+    "127\n"
+    "60\n"
+    "69\n"
+    "440.0\n"
+    "7\n"
+    "! mapeo\n"
+    "0\n" "x\n" "1\n" "x\n" "2\n" "3\n" "x\n" "4\n" "x\n" "5\n" "x\n" "6\n";
+
+static bool loadScale(Tuning& t, const std::string& text) {
+    std::istringstream in(text);
+    return t.loadScale(in);
+}
+
+static bool loadMap(Tuning& t, const std::string& text) {
+    std::istringstream in(text);
+    return t.loadKeyboardMapping(in);
+}
+
+static double cents(double ratio) { return 1200.0 * std::log2(ratio); }
+
+// Mayor diferencia en cents entre f(note) / f(base) y el intervalo esperado
+static double intervalError(const Tuning& t, int base, const int* notes, const double* expectedCents, int count) {
+    double error = 0.0;
+    for (int i = 0; i < count; i++) {
+        error = std::max(error, std::fabs(cents(t.getFrequency(notes[i]) / t.getFrequency(base)) - expectedCents[i]));
+    }
+    return error;
+}
+
+static bool sameFrequencies(const Tuning& a, const Tuning& b) {
+    for (int n = 0; n < NUM_NOTES; n++) {
+        if (a.getFrequency(n) != b.getFrequency(n)) return false;
+    }
+    return true;
+}
+
+static void checkDefault() {
+    Tuning t;
+    checkBelow("12-TET, A4 - 440 Hz", std::fabs(t.getFrequency(69) - 440.0), 1e-9);
+    checkBelow("12-TET, C4 - 261.626 Hz", std::fabs(t.getFrequency(60) - 261.6255653), 1e-6);
+}
+
+static void checkScale() {
+    Tuning t;
+    checkTrue("escala con comentarios, razones y cents", loadScale(t, JUST_SCALE));
+    // Mapeo lineal: la 60 es el grado 0 y cada tecla sube un grado
+    const int notes[] = {61, 62, 63, 64, 65, 66, 67, 72};
+    const double expected[] = {cents(9.0 / 8.0), cents(5.0 / 4.0), cents(4.0 / 3.0), cents(1.5),
+                               884.35871, cents(15.0 / 8.0), 1200.0, 1200.0 + 884.35871};
+    checkBelow("grados de la escala justa (cents)", intervalError(t, 60, notes, expected, 8), 1e-6);
+    checkBelow("la referencia sigue en 440 Hz", std::fabs(t.getFrequency(69) - 440.0), 1e-9);
+}
+
+static void checkKeyboardMapping() {
+    Tuning t;
+    loadScale(t, JUST_SCALE);
+    checkTrue("mapeo con teclas x", loadMap(t, WHITE_KEYS_MAP));
+    bool unmapped = true;
+    const int blackKeys[] = {61, 63, 66, 68, 70, 73, 49};
+    for (int note : blackKeys) unmapped = unmapped && t.getFrequency(note) == 0.0;
+    checkTrue("las teclas x no tienen nota", unmapped);
+
+    // Las blancas recorren la escala y el patron sube la octava formal (grado 7)
+    const int notes[] = {62, 64, 65, 67, 69, 71, 72, 48};
+    const double expected[] = {cents(9.0 / 8.0), cents(5.0 / 4.0), cents(4.0 / 3.0), cents(1.5),
+                               884.35871, cents(15.0 / 8.0), 1200.0, -1200.0};
+    checkBelow("teclas blancas sobre la escala (cents)", intervalError(t, 60, notes, expected, 8), 1e-6);
+    checkBelow("la 69 (grado 5) en 440 Hz", std::fabs(t.getFrequency(69) - 440.0), 1e-9);
+
+    // Las entradas que faltan al final quedan sin nota
+    Tuning partial;
+    loadScale(partial, JUST_SCALE);
+    checkTrue("mapeo con entradas de menos", loadMap(partial, "4\n0\n127\n60\n60\n261.0\n2\n0\n1\n"));
+    checkTrue("las que faltan no suenan",
+              partial.getFrequency(61) > 0.0 && partial.getFrequency(62) == 0.0 && partial.getFrequency(63) == 0.0 &&
+              partial.getFrequency(64) > 0.0);
+}
+
+static void checkRejected() {
+    Tuning t;
+    loadScale(t, JUST_SCALE);
+    loadMap(t, WHITE_KEYS_MAP);
+    const Tuning before = t;
+
+    const char* badScales[] = {
+        "",                                     // vacio
+        "solo descripcion\n",
+        "corta\n 5\n 9/8\n 5/4\n 2/1\n",        // 3 grados de 5
+        "cero grados\n 0\n",
+        "cuenta invalida\n abc\n 2/1\n",
+        "grado invalido\n 2\n 9/8\n abc\n",
+        "denominador cero\n 1\n 3/0\n",
+        "barra sin denominador\n 1\n 3/\n",
+        "razon cero\n 1\n 0\n",
+        "razon negativa\n 1\n -3/2\n",
+        "cents no finitos\n 1\n nan.\n",
+        "periodo no positivo\n 1\n -100.0\n",
+        "! solo comentarios\n!\n",
+    };
+    int accepted = 0;
+    for (const char* text : badScales) {
+        if (loadScale(t, text)) {
+            std::printf("escala aceptada: %s\n", text);
+            accepted++;
+        }
+    }
+    checkTrue("escalas cortas o invalidas rechazadas", accepted == 0);
+
+    const char* badMaps[] = {
+        "",
+        "12\n0\n127\n60\n",                                 // cabecera cortada
+        "12\n0\n127\n60\n69\n440.0\n",                      // falta la octava
+        "1000000\n0\n127\n60\n69\n440.0\n12\n0\n",          // mas grande que el teclado
+        "-1\n0\n127\n60\n69\n440.0\n12\n",
+        "12\n100\n20\n60\n69\n440.0\n12\n0\n",              // primera despues de la ultima
+        "12\n0\n200\n60\n69\n440.0\n12\n0\n",               // nota fuera de rango
+        "12\n0\n127\n60\n69\n0\n12\n0\n",                   // referencia en 0 Hz
+        "12\n0\n127\n60\n69\nabc\n12\n0\n",
+        "12\n0\n127\n60\n69\n440.0\n-7\n0\n",               // octava negativa
+        "2\n0\n127\n60\n69\n440.0\n12\n0\nfoo\n",           // entrada que no es grado ni x
+        "2\n0\n127\n60\n69\n440.0\n12\n0\n-3\n",            // grado negativo
+    };
+    accepted = 0;
+    for (const char* text : badMaps) {
+        if (loadMap(t, text)) {
+            std::printf("mapeo aceptado: %s\n", text);
+            accepted++;
+        }
+    }
+    checkTrue("mapeos cortos o invalidos rechazados", accepted == 0);
+    checkTrue("la afinacion anterior queda igual", sameFrequencies(t, before));
+    checkTrue("un archivo que no existe se rechaza", !t.loadScale("no_existe.scl") && !t.loadKeyboardMapping("no_existe.kbm"));
+}
+
+int main() {
+    checkDefault();
+    checkScale();
+    checkKeyboardMapping();
+    checkRejected();
+    return testResult();
+}
@@ -0,0 +1,137 @@
+// Bancos y tablas de usuario reemplazados: el anterior queda vivo hasta que
+// termina un render (una voz lo puede estar leyendo) y despues se libera, asi
+// recargar muchas veces no acumula mapeos. El registro de bancos abiertos
+// vuelve a mapear un archivo que ya nadie usaba.
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "synth/engine.h"
+#include "test_check.h"
+
+static const double TEST_SAMPLE_RATE = 48000.0;
+static const int BLOCK_FRAMES = 256;
+static const char* SAW_PATH = "wavetable_bank_test_saw.wav";
+static const char* SQUARE_PATH = "wavetable_bank_test_square.wav";
+static const char* BANK_A = "wavetable_bank_test_a.fmwt";
+static const char* BANK_B = "wavetable_bank_test_b.fmwt";
+
+// Un ciclo de WAVETABLE_SIZE samples como WAV PCM 16 bits mono
+static bool writeCycle(const char* path, bool square) {
+    std::vector<int16_t> pcm(WAVETABLE_SIZE);
+    for (int i = 0; i < WAVETABLE_SIZE; i++) {
+        const double phase = (double)i / WAVETABLE_SIZE;
+        pcm[i] = (int16_t)(20000.0 * (square ? (phase < 0.5 ? 1.0 : -1.0) : 2.0 * phase - 1.0));
+    }
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    auto write32 = [f](uint32_t v) { std::fwrite(&v, 4, 1, f); };
+    auto write16 = [f](uint16_t v) { std::fwrite(&v, 2, 1, f); };
+    std::fwrite("RIFF", 1, 4, f);
+    write32(36 + 2 * WAVETABLE_SIZE);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    write32(16);
+    write16(1);                             // PCM
+    write16(1);
+    write32((uint32_t)TEST_SAMPLE_RATE);
+    write32((uint32_t)TEST_SAMPLE_RATE * 2);
+    write16(2);
+    write16(16);
+    std::fwrite("data", 1, 4, f);
+    write32(2 * WAVETABLE_SIZE);
+    std::fwrite(pcm.data(), 2, WAVETABLE_SIZE, f);
+    std::fclose(f);
+    return true;
+}
+
+static double renderPeak(SynthEngine<Sample>& engine) {
+    std::vector<Sample> buffer(2 * BLOCK_FRAMES);
+    engine.render(buffer.data(), BLOCK_FRAMES);
+    double peak = 0.0;
+    for (Sample s : buffer) peak = std::max(peak, (double)std::fabs(s));
+    return peak;
+}
+
+static void checkBankReplace() {
+    auto engine = std::make_unique<SynthEngine<Sample>>();
+    engine->prepare(TEST_SAMPLE_RATE);
+    engine->setOperatorWaveform(0, WAVE_BANK);
+    checkTrue("carga el banco A", engine->loadWavetableBank(BANK_A));
+    engine->noteOn(60, 1.0);
+    renderPeak(*engine);
+
+    std::weak_ptr<const WavetableBank> bankA = openWavetableBank(BANK_A);
+    checkTrue("carga el banco B", engine->loadWavetableBank(BANK_B));
+    engine->collectRetiredTables();
+    checkTrue("sin render el banco A sigue mapeado", !bankA.expired() && engine->getRetiredTableCount() == 1);
+    checkTrue("la voz sigue sonando con el banco B", renderPeak(*engine) > 0.01);
+    engine->collectRetiredTables();
+    checkTrue("despues de un render el banco A se libera", bankA.expired() && engine->getRetiredTableCount() == 0);
+
+    // Dos cargas sin render en el medio: las dos retiradas esperan
+    engine->loadWavetableBank(BANK_A);
+    engine->loadWavetableBank(BANK_B);
+    checkTrue("sin render no se libera ninguna", engine->getRetiredTableCount() == 2);
+
+    // Recargar muchas veces con el audio corriendo no acumula bancos
+    int maxRetired = 0;
+    for (int i = 0; i < 200; i++) {
+        renderPeak(*engine);
+        engine->loadWavetableBank(i % 2 ? BANK_B : BANK_A);
+        maxRetired = std::max(maxRetired, engine->getRetiredTableCount());
+    }
+    renderPeak(*engine);
+    engine->collectRetiredTables();
+    std::printf("retiradas como maximo: %d\n", maxRetired);
+    checkTrue("200 recargas dejan a lo sumo una retirada", maxRetired == 1 && engine->getRetiredTableCount() == 0);
+    // Abrir solo para mirar: si nadie mas lo tiene, se libera al salir
+    const std::weak_ptr<const WavetableBank> bankB = openWavetableBank(BANK_B);
+    bankA = openWavetableBank(BANK_A);
+    checkTrue("el banco actual queda mapeado y el otro no", !bankB.expired() && bankA.expired());
+    checkTrue("el banco actual es B", std::string(engine->getBankTableName(0)) == SQUARE_PATH);
+
+    // prepare() corre sin stream: libera lo retirado sin esperar
+    engine->loadWavetableBank(BANK_A);
+    engine->prepare(TEST_SAMPLE_RATE);
+    checkTrue("prepare libera lo retirado", engine->getRetiredTableCount() == 0);
+}
+
+static void checkUserReplace() {
+    auto engine = std::make_unique<SynthEngine<Sample>>();
+    engine->prepare(TEST_SAMPLE_RATE);
+    engine->setOperatorWaveform(0, WAVE_USER);
+    checkTrue("carga la tabla de usuario", engine->loadUserWavetable(SAW_PATH));
+    engine->noteOn(60, 1.0);
+    int maxRetired = 0;
+    for (int i = 0; i < 50; i++) {
+        renderPeak(*engine);
+        engine->loadUserWavetable(i % 2 ? SAW_PATH : SQUARE_PATH);
+        maxRetired = std::max(maxRetired, engine->getRetiredTableCount());
+    }
+    checkTrue("la voz suena con la ultima tabla", renderPeak(*engine) > 0.01);
+    engine->collectRetiredTables();
+    checkTrue("50 recargas de usuario dejan a lo sumo una retirada",
+              maxRetired == 1 && engine->getRetiredTableCount() == 0);
+}
+
+static void checkRegistry() {
+    checkTrue("un banco que no existe no abre", !openWavetableBank("no_existe.fmwt"));
+    checkTrue("ni la segunda vez", !openWavetableBank("no_existe.fmwt"));
+    std::shared_ptr<const WavetableBank> first = openWavetableBank(BANK_A);
+    checkTrue("el mismo archivo comparte el mapeo", first && openWavetableBank(BANK_A) == first);
+    first.reset();
+    std::shared_ptr<const WavetableBank> again = openWavetableBank(BANK_A);
+    checkTrue("liberado se vuelve a mapear", again && again->getCount() == 1);
+}
+
+int main() {
+    checkTrue("escribe los ciclos", writeCycle(SAW_PATH, false) && writeCycle(SQUARE_PATH, true));
+    checkTrue("arma los bancos", writeWavetableBank(BANK_A, {SAW_PATH}) && writeWavetableBank(BANK_B, {SQUARE_PATH}));
+    checkBankReplace();
+    checkUserReplace();
+    checkRegistry();
+    const char* paths[] = {SAW_PATH, SQUARE_PATH, BANK_A, BANK_B};
+    for (const char* path : paths) std::remove(path);
+    return testResult();
+}